@@ -19,7 +19,7 @@
 
 // --- Pinout Configuration ---
 const int PIN_LED_BUILTIN = 13; // Built-in LED for error indication
-// MUST use digital pin that support interrupts for the button.
+// MUST use digital pin that support interrupts for the button (a pin-change interrupt catches aborts mid-run).
 const int PIN_BUTTON = 4; // Push to make button for menu navigation
 const int PIN_SEND_CLICK = 5; // Pin to send a mouse click signal (output)
 const int PIN_MOUSE_PRESENCE = 21; // Analog pin to detect mouse presence (input) (3.3V~)
@@ -46,27 +46,136 @@ const int MOUSE_PRESENCE_MIN_ADC_VALUE = 216;
 // Calculation: (0.3 / 3.3) * 255 = ~23.
 const int MOUSE_STABILITY_THRESHOLD_ADC = 23;
 
-// This sets how long the script will hold the mouse click signal when sending via USB,
-// the higher this number, the higher latency you will see added from this value.
-// The Teensy 4.1 has been modified to run at 8000 Hz polling rate for USB HID devices. So this value should be set to 250 for Direct modes, or to minmax 140.
-// If you want to be safe, set it to DOUBLE the poll time of your mouse.
-// At 8k Hz polling rate, each poll is 125 microseconds, so holding for slightly longer is recommended (140 microseconds)
-// At 4k Hz polling rate, each poll is 250 microseconds...
-// At 2k Hz polling rate, each poll is 500 microseconds...
-// At 1k Hz polling rate, each poll is 1000 microseconds...
-// At 500 Hz polling rate, each poll is 2000 microseconds...
-// At 250 Hz polling rate, each poll is 4000 microseconds...
-const int MOUSE_CLICK_HOLD_MICROS = 140;
+// --- USB Polling Rate ---
+// The mouse endpoint's polling rate is chosen per build: each PlatformIO environment in platformio.ini
+// (teensy41 = 8 kHz, teensy41_4khz, teensy41_2khz, teensy41_1khz) passes -D USB_POLL_RATE_HZ, and
+// scripts/usb_polling_rate.py patches the Teensy core's MOUSE_INTERVAL to match.
+#ifndef USB_POLL_RATE_HZ
+#define USB_POLL_RATE_HZ 8000
+#endif
+static_assert(USB_POLL_RATE_HZ == 8000 || USB_POLL_RATE_HZ == 4000 || USB_POLL_RATE_HZ == 2000 || USB_POLL_RATE_HZ == 1000,
+              "USB_POLL_RATE_HZ must be 8000, 4000, 2000 or 1000");
+constexpr unsigned long USB_POLL_INTERVAL_MICROS = 1000000UL / USB_POLL_RATE_HZ; // 125 us at 8 kHz
+constexpr unsigned long USB_POLL_MICROFRAMES = 8000 / USB_POLL_RATE_HZ; // High Speed microframes per host poll
+
+// Polling rate of the mouse wired to PIN_SEND_CLICK. It is the same as the Teensy's by default, set it
+// to the mouse's own rate if that differs.
+constexpr unsigned long MOUSE_POLL_RATE_HZ = USB_POLL_RATE_HZ;
+
+// How long the mouse switch is held, derived from the mouse's polling rate: one poll interval plus 1/8
+// for clock drift, so a poll always lands inside the press (140 us at 8 kHz, 1125 us at 1 kHz). A shorter
+// hold can fall between two polls and be missed, a longer one only delays the release.
+constexpr int MOUSE_CLICK_HOLD_MICROS = 1000000UL / MOUSE_POLL_RATE_HZ * 9 / 8;
 // ^ IMPORTANT: This delay is only for UE4 modes. Automatic mode holds down the click until it detects LIGHT_SENSOR_THRESHOLD, then lets go.
 
+// --- Direct Mode USB Timing ---
+// Direct modes time every click against the host's polls of the mouse endpoint and log the wait from the
+// click to the next poll, so the USB queueing term can be separated from the rest of the chain. At 8 kHz
+// every 125 us microframe carries a poll, below that only every USB_POLL_MICROFRAMES-th one does. Which
+// one is up to the host, so it is measured at the start of each Direct session. If that fails, the
+// offset is not recorded and the click is not phased.
+// 0 = Free:       click as soon as the screen is ready, only record the offset.
+// 1 = Aligned:    wait for a poll plus USB_CLICK_PHASE_MICROS, then click (removes the USB term's spread).
+// 2 = Randomized: like Aligned with a uniformly random phase each run (the USB term becomes a known uniform distribution).
+const int USB_CLICK_PHASE_MODE = 0;
+const unsigned int USB_CLICK_PHASE_MICROS = 0; // Phase (0 to USB_POLL_INTERVAL_MICROS - 1) used by the Aligned mode
+
+// --- Direct Motion Mode ---
+// The Direct Motion mode times camera motion instead of a click. The Teensy sends single mouse move reports of
+// MOTION_STEP_X / MOTION_STEP_Y counts, alternately forward and back, with the same USB poll timing as
+// the Direct click modes. Aim in game so that a high-contrast edge (e.g. a dark wall against the sky) sits
+// right next to the light sensor: one step moves it across the sensor and the next one moves it back,
+// so every step is one B-to-W or W-to-B run. Pick the step (with the game's sensitivity) so it clearly
+// clears the edge, but stays small enough that no other scenery reaches the sensor.
+const int MOTION_STEP_X = 40; // Counts per step, -127 to 127
+const int MOTION_STEP_Y = 0;
+
 // --- Behavior Settings ---
 const unsigned long BUTTON_HOLD_START_MS = 250; // Time in ms to start showing hold action
 const unsigned long BUTTON_HOLD_DURATION_MS = 800; // Time in ms to hold button for SELECT
 const unsigned long BUTTON_DEBUG_DURATION_MS = 1300; // Time in ms to hold button for DEBUG
 const unsigned long BUTTON_RESET_DURATION_MS = 1800; // Time in ms to hold for a global RESET
-const unsigned long FLUC_CHECK_DURATION_MS = 1500; // Duration to check sensor/mouse stability
 const unsigned long MEASUREMENT_TIMEOUT_MICROS = 1000000; // Max time (us) to wait for light change before failing a run. (1 second)
 
+// --- Boot Self-Check ---
+// The light sensor (ADC1 stream) and the mouse presence pin (ADC2) are checked together in one loop.
+// A failing check always runs the full window; a clean one can pass early, once both signals have been
+// watched for BOOT_CHECK_EARLY_PASS_MS with fluctuations under BOOT_CHECK_EARLY_PASS_MARGIN times their limits.
+const unsigned long BOOT_CHECK_DURATION_MS = 500;   // Longest check window
+const unsigned long BOOT_CHECK_SAMPLE_MICROS = 250; // Spacing between samples of each signal
+const unsigned long BOOT_CHECK_EARLY_PASS_MS = 100; // 0 = always run the full window
+const float BOOT_CHECK_EARLY_PASS_MARGIN = 0.5f;
+
+// --- Light Sensor Sampling Engine ---
+// ADC1 runs in continuous conversion mode on PIN_LIGHT_SENSOR and DMA copies every 8-bit result into a ring buffer.
+// The ring size MUST be a power of two (the DMA uses modulo addressing). 4096 samples is a few ms of history,
+// the measurement loops drain it far faster than it fills. The 1 and 2 kHz builds use 16384: a Direct click
+// waits for up to ~3 poll intervals, and the ring must not lap in that time (checked on boot).
+const unsigned int SAMPLE_RING_SIZE = USB_POLL_RATE_HZ >= 4000 ? 4096 : 16384;
+// The real conversion rate is measured over a short window on boot and then refined between the runs of
+// the first session over a long one, from the same ADC1 counter. Latency is extrapolated as samples x
+// this rate, so a relative error of 1e-6 is already 0.1 us on a 100 ms run.
+const unsigned long SAMPLE_RATE_CALIBRATION_MICROS = 20000;  // Boot window (us)
+const unsigned long SAMPLE_RATE_REFINE_MICROS = 1000000;     // Refinement window (us)
+const unsigned long SAMPLE_PHASE_CALIBRATION_MICROS = 20000; // Window (us) used on boot to measure the ADC2 offset
+// Interleaved sampling: ADC2 also converts PIN_LIGHT_SENSOR, half a conversion period after ADC1, into a
+// second ring. The two streams are merged into one timeline at twice the sample rate. ADC2 is then only
+// borrowed briefly for mouse presence reads outside of measurements. Not compatible with hardware edge detection.
+const bool ENABLE_INTERLEAVED_SAMPLING = false;
+
+// --- Multi-Sensor Scanout ---
+// Extra light sensors at other screen positions, e.g. PIN_LIGHT_SENSOR at the top and these in the middle and
+// at the bottom. In the Auto modes every click is then timed at every position, so one session shows how the
+// scanout delay changes across the panel. The main sensor keeps its DMA stream on ADC1 while the extra pins
+// are converted round-robin on ADC2, so they MUST be analog pins ADC2 can read. Not compatible with
+// interleaved sampling. The UE4 modes always use the main sensor only.
+const int MAX_EXTRA_LIGHT_SENSORS = 3;
+const int EXTRA_LIGHT_SENSOR_COUNT = 0; // 0 = single sensor, up to MAX_EXTRA_LIGHT_SENSORS
+const int EXTRA_LIGHT_SENSOR_PINS[MAX_EXTRA_LIGHT_SENSORS] = {22, 20, 17};
+// Per-sensor thresholds, 0 = same as the main light/dark threshold
+const int EXTRA_LIGHT_SENSOR_LIGHT_THRESHOLDS[MAX_EXTRA_LIGHT_SENSORS] = {0, 0, 0};
+const int EXTRA_LIGHT_SENSOR_DARK_THRESHOLDS[MAX_EXTRA_LIGHT_SENSORS] = {0, 0, 0};
+
+// --- Click-to-Sound Channel ---
+// A microphone envelope (e.g. an electret module with a peak detector) on PIN_AUDIO_INPUT is timed from the
+// same click as the light sensor in the Auto modes. It is converted on ADC2 in turn with the extra light
+// sensors, so one click gives both the click-to-photon and the click-to-sound latency. The sound has its
+// own stats (line "Snd" on the SCAN page) and its own log rows (Sensor "Audio", Run = the light run of the
+// same click). Before every click the envelope must be back below AUDIO_QUIET_THRESHOLD. The click is held
+// until the sound is detected or the measurement timeout passes. PIN_AUDIO_INPUT MUST be an analog pin
+// ADC2 can read. This cannot be combined with interleaved sampling.
+const bool ENABLE_AUDIO_CHANNEL = false;
+const int PIN_AUDIO_INPUT = 15;
+const int AUDIO_THRESHOLD = 60;       // Envelope level (8-bit ADC counts) that counts as sound
+const int AUDIO_QUIET_THRESHOLD = 30; // Envelope level the sound must have decayed below before a click
+
+// --- Edge Detection Mode ---
+// false = Software: the DMA sample ring is scanned for the first sample past the threshold.
+// true  = Hardware: the threshold is programmed into ADC1's compare unit and the crossing is latched
+//         and timestamped by the ADC interrupt, removing the software loop from the critical path.
+const bool ENABLE_HARDWARE_EDGE_DETECT = false;
+// Software detector only: place the edge between the last sample before the threshold and the first
+// one past it by linear interpolation, instead of at the later sample. Removes the up-to-one-sample
+// late bias. The hardware detector keeps no samples and always reports the crossing conversion.
+const bool ENABLE_EDGE_INTERPOLATION = true;
+// Software detector only: filter stage between the sample stream and the threshold compare, against PWM
+// backlights, flicker and ADC noise tripping the detector early. The edge is moved back to where the raw
+// signal crossed, so the reported latency stays that of the raw signal.
+// 0 = Raw:            the first sample past the threshold is the edge.
+// 1 = N-of-M:         EDGE_FILTER_CONFIRM of the last EDGE_FILTER_WINDOW samples must be past it. The edge is
+//                     the first of them, so there is no delay to remove.
+// 2 = Moving average: the mean of the last EDGE_FILTER_WINDOW samples is compared. The edge is the last raw
+//                     crossing in the window that confirmed it (its lag depends on the step height).
+// 3 = Median:         the median of the last EDGE_FILTER_WINDOW (odd) samples. Ignores spikes shorter than
+//                     half the window. Delay (WINDOW - 1) / 2 for a clean step.
+// EDGE_FILTER_HYSTERESIS (ADC counts) additionally keeps the detector disarmed until the filtered signal
+// has been that far on the starting side of the threshold, so a level hovering at it can't trigger.
+// Keep it below the distance between the idle level and the threshold, or every run times out.
+const int EDGE_FILTER_MODE = 0;
+const int EDGE_FILTER_WINDOW = 5;  // Samples, 2 to 15
+const int EDGE_FILTER_CONFIRM = 3; // N-of-M only, 1 to EDGE_FILTER_WINDOW
+const int EDGE_FILTER_HYSTERESIS = 0;
+
 // --- Display Configuration ---
 // I2C pins for the OLED display (Wire) = Teensy 4.1 default I2C pins are 18 (SDA) and 19 (SCL)
 const int SCREEN_WIDTH = 128; // OLED display width, in pixels
@@ -74,19 +183,132 @@ const int SCREEN_HEIGHT = 64; // OLED display height, in pixels
 const byte SCREEN_ADDRESS = 0x3C; // I2C address for the OLED display, could be 0x3C or 0x3D depending on the module
 const int OLED_RESET = -1; // Reset pin # (or -1 if sharing Arduino reset pin)
 const char* GITHUB_TAG = "GitHub: S4N-T0S"; // Pls no remove this simple credit :)
+const uint32_t OLED_I2C_CLOCK_HZ = 400000; // I2C clock for display transfers (SSD1306 is rated for 400 kHz)
+const unsigned long STATS_REFRESH_INTERVAL_MS = 100; // Max stats screen refresh rate while measuring (100 ms = 10 Hz)
 
 // --- Timing Configuration ---
 // Add a delay between runs to allow system to stabilize and, allow the monitor to dim back.
+// The delay runs on a hardware timer, the display, SD card and host are served while it counts down.
 const unsigned long AUTO_MODE_RUN_DELAY_MS = 750;
 const unsigned long UE4_MODE_RUN_DELAY_MS = 250;
 const int MODE_DELAY_JITTER_MS = 10;
+// Adaptive pacing: instead of always waiting the full run delay, start the next run once the sensor has
+// held the expected level (dark after an Auto run) for ADAPTIVE_SETTLE_MS, plus a random 0 to
+// ADAPTIVE_JITTER_MS so clicks don't lock onto the frame phase. The run delays above become the upper limit.
+const bool ENABLE_ADAPTIVE_PACING = false;
+const unsigned long ADAPTIVE_SETTLE_MS = 60;     // Time the level must stay stable
+const unsigned long ADAPTIVE_JITTER_MS = 20;     // Keep at least one frame period (e.g. 17 ms at 60 Hz)
+const unsigned long ADAPTIVE_MIN_DELAY_MS = 150; // Never start sooner, gives the game time between clicks
+// Fast soak: drop ADAPTIVE_MIN_DELAY_MS so runs follow each other as fast as the display settles.
+const bool ENABLE_FAST_SOAK = false;
+// Frame phase scheduling: at the start of a session the refresh period is found from the ripple the backlight
+// or scanout leaves in the sensor signal. Every click is then delayed to a phase of the frame, stepping through
+// FRAME_PHASE_STRATA evenly spaced slots in random order, so the one-frame spread of the results averages out
+// in fewer runs. The FRAME stats page shows the detected rate and the phase-balanced mean. A PWM-dimmed
+// backlight can be picked up instead of the refresh rate, use 100% brightness. Without a clear ripple the
+// session runs unscheduled.
+const bool ENABLE_FRAME_PHASE_SCHEDULING = false;
+const unsigned long REFRESH_DETECT_WINDOW_MS = 250;   // Signal recorded for the detection
+const unsigned long REFRESH_DETECT_BIN_MICROS = 50;   // Samples are averaged into bins of this width
+const float REFRESH_MIN_HZ = 40.0f;
+const float REFRESH_MAX_HZ = 500.0f;
+const float REFRESH_MIN_CORRELATION = 0.5f;           // Autocorrelation the ripple must reach at one period
+const int FRAME_PHASE_STRATA = 8;                     // Phase slots per frame (max 32)
 
 // --- Run Limit Configuration ---
 // This array defines the options in the "Select Run Limit" menu.
 const unsigned long RUN_LIMIT_OPTIONS[] = {10, 100, 300, 500};
 
+// "Until +/-" option: the session stops on its own once the 95% confidence interval of the mean latency
+// is narrower than +/- PRECISION_TARGET_MICROS (in UE4 modes, for both directions). PRECISION_MIN_RUNS
+// keeps a lucky start from stopping it early, PRECISION_MAX_RUNS is the hard cap for noisy setups.
+const bool ENABLE_PRECISION_RUN_LIMIT = true;
+const float PRECISION_TARGET_MICROS = 100.0f;
+const unsigned long PRECISION_MIN_RUNS = 30;
+const unsigned long PRECISION_MAX_RUNS = 2000;
+
+// --- Baseline Comparison ---
+// A completed session can be kept on the SD card as the baseline of its mode. The baseline holds the run
+// count, mean, p50/p99 and a latency histogram of BASELINE_HISTOGRAM_BINS log-spaced bins between the two
+// limits; latencies outside them fall into the end bins. Every later completed session of that mode gets a
+// CMP stats page with the change in mean and p99 against it. A Mann-Whitney U test on the two histograms
+// decides whether the change is significant at BASELINE_SIGNIFICANCE (BETTER/WORSE) or not (SAME).
+// Holding SELECT on the CMP page saves the shown session as the new baseline. With BASELINE_AUTO_SAVE the
+// first completed session of a mode becomes its baseline by itself.
+const bool ENABLE_BASELINE_COMPARISON = true;
+const int BASELINE_HISTOGRAM_BINS = 128;
+const float BASELINE_HISTOGRAM_MIN_MS = 0.5f;
+const float BASELINE_HISTOGRAM_MAX_MS = 500.0f;
+const float BASELINE_SIGNIFICANCE = 0.01f; // Two-sided p-value below which a change counts
+const bool BASELINE_AUTO_SAVE = true;
+
+// --- PSRAM Run Store ---
+// Keeps every run of the session in the Teensy 4.1's optional PSRAM chip (soldered on the bottom pads).
+// The arena is sized at compile time, nothing is allocated during measurement. When the session completes
+// the stored runs replace the streaming p50/p90/p99 estimates with exact values.
+// Ignored automatically if no PSRAM is fitted. 200000 runs use ~7 MB of an 8 MB chip.
+const bool ENABLE_PSRAM_RUN_STORE = true;
+const unsigned long PSRAM_RUN_STORE_CAPACITY = 200000;
+
+// --- Waveform Capture ---
+// UE4 modes can also record the light sensor trace around every transition into PSRAM: from
+// WAVEFORM_PRE_TRIGGER_MICROS before the threshold crossing to WAVEFORM_POST_TRIGGER_MICROS after it,
+// averaged into points of WAVEFORM_POINT_MICROS (0 = every ADC sample). Each trace is measured on the device:
+// 10-90% rise (or fall) time, settle time from the 10% point until it stays within WAVEFORM_SETTLE_BAND of
+// the final level, and overshoot past it, averaged on the WAVE stats page. The raw traces go to a .wfm file
+// next to the SD log and/or out as telemetry frames between runs (see scripts/ldat_waveform.py). A
+// transition that comes while the previous trace is still being sent is not captured.
+// Needs PSRAM and the software edge detector; the pre-trigger window is limited by the sample ring.
+const bool ENABLE_WAVEFORM_CAPTURE = false;
+const unsigned long WAVEFORM_PRE_TRIGGER_MICROS = 2000;
+const unsigned long WAVEFORM_POST_TRIGGER_MICROS = 60000;
+const float WAVEFORM_POINT_MICROS = 10.0f;
+const float WAVEFORM_SETTLE_BAND = 0.05f;        // Fraction of the swing
+const unsigned long WAVEFORM_MAX_POINTS = 65536; // PSRAM trace buffer, 2 bytes per point
+const bool WAVEFORM_LOG_SD = true;
+const bool WAVEFORM_STREAM_SERIAL = true;
+
+// --- Serial Telemetry ---
+// Every run is sent to the host as a small binary frame over the USB serial port (see scripts/ldat_telemetry.py).
+// Frames are queued in RAM and only written between runs, when the USB buffer has room, so sending never
+// delays a measurement. Frames that don't fit in the queue are dropped and counted.
+const bool ENABLE_SERIAL_TELEMETRY = true;
+const unsigned int TELEMETRY_BUFFER_SIZE = 2048; // Bytes of outgoing frames held while the host catches up
+
+// --- Threshold Calibration ---
+// Debug Menu > Calibrate toggles the test screen and sets the light/dark thresholds from the measured levels.
+const int CALIBRATION_CYCLES = 3;               // Dark/light toggle pairs measured
+const unsigned long CALIBRATION_SETTLE_MS = 400; // Wait after each click before measuring the level
+const unsigned long CALIBRATION_WINDOW_MS = 100; // Averaging window per level
+const int CALIBRATION_DARK_PERCENT = 10;        // Dark threshold, percent of the swing above the floor
+const int CALIBRATION_LIGHT_PERCENT = 50;       // Light threshold, percent of the swing above the floor
+const float CALIBRATION_MIN_SWING = 8.0f;       // Minimum floor-to-peak difference in ADC counts
+
+// --- Instrument Benchmark ---
+// Debug Menu > Benchmark times the tester's own primitives and, with an LED on the click pin aimed at the
+// light sensor, the whole click-to-detection path. The loopback result is the instrument's own latency.
+const int BENCHMARK_ITERATIONS = 1000;               // Samples per CPU-side primitive
+const int BENCHMARK_DISPLAY_ITERATIONS = 64;         // Display page transfers (each takes a few ms)
+const int BENCHMARK_LOOPBACK_RUNS = 50;              // Loopback clicks, skipped if the first one sees no light
+const unsigned long BENCHMARK_LOOPBACK_DELAY_MS = 20; // Gap after the LED has gone dark again (plus jitter)
+
+// --- Polling Test ---
+// Debug Menu > Polling Test counts the mouse reports the host accepts against the polls the bus offers
+// (8000/s at High Speed, 8/ms). The screen only updates once per window so the drawing barely dents the rate.
+const unsigned long POLLING_TEST_WINDOW_MS = 1000;
+
+// --- Host Commands ---
+// Lets a PC change settings and start/stop modes over the USB serial port (see scripts/ldat_command.py).
+// The light/dark/fluctuation thresholds, click hold, run delays and jitter, measurement timeout, USB click
+// phase and run limit options in this file are then only the defaults: values set from the host are kept
+// in EEPROM and loaded on boot. Commands are handled between runs, never during a measurement.
+const bool ENABLE_HOST_COMMANDS = true;
+
 // --- SD Card Logging ---
 // Saves latency results on run completion. SD card must be FAT32 formatted.
 const bool ENABLE_SD_LOGGING = false; // Set to true to enable logging to SD card
 const char* SD_LOG_DIRECTORY = "/latency_logs"; // Directory to store log files. Must start with a '/'.
-const int UNLIMITED_MODE_SAVE_INTERVAL = 50; // How often to save logs in unlimited mode (in runs)
\ No newline at end of file
+// Runs are streamed to a compact binary .bin log during the session (see scripts/ldat_log_to_csv.py).
+const unsigned long SD_LOG_PREALLOCATE_RUNS = 100000; // Contiguous space reserved up front (32 bytes per run)
+const int SD_LOG_SYNC_INTERVAL_SECTORS = 16; // Commit the file size every N sectors (16 runs each) to limit loss on power-off
+const bool SD_LOG_EXPORT_CSV = true; // Also write a .csv copy of the log when the session ends
\ No newline at end of file
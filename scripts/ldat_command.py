@@ -0,0 +1,138 @@
+"""
+    Open-Source-LDAT - Latency Detection and Analysis Tool
+    Copyright (C) 2025 S4N-T
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later versio
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more detail
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ """
+# Changes settings and controls measurement runs over the device's USB serial port.
+# Usage: python ldat_command.py <port> <command> [args]        (requires pyserial: pip install pyserial)
+#   ping | get | save | defaults | stop | stats | baseline
+#   set <param> <value>        e.g. set light_threshold 20      (run 'get' for the parameter names)
+#   start <mode> [runs]        mode = auto | direct_auto | auto_ue4 | direct_ue4 | direct_motion, runs = 0 for unlimited
+#                              or 'precise' to stop at the PRECISION_TARGET_MICROS confidence interval
+# 'set' and 'defaults' change the live settings only, follow them with 'save' to keep them across reboots.
+# 'baseline' stores the just completed session on the SD card as the baseline its mode is compared against.
+#
+# Uses the same framing as the telemetry stream (see ldat_telemetry.py), command codes must match
+# the Host Commands section of src/main.cpp.
+
+import struct
+import sys
+
+from ldat_telemetry import FRAME_SYNC, MODES, read_frames
+
+CMD_PING = 0x80
+CMD_GET_CONFIG = 0x81
+CMD_SET_PARAM = 0x82
+CMD_SAVE_CONFIG = 0x83
+CMD_LOAD_DEFAULTS = 0x84
+CMD_START = 0x85
+RUN_LIMIT_PRECISION = 0xFFFFFFFF
+CMD_STOP = 0x86
+CMD_QUERY_STATS = 0x87
+CMD_SAVE_BASELINE = 0x88
+
+FRAME_TYPE_ACK = 0x03
+FRAME_TYPE_CONFIG = 0x04
+FRAME_TYPE_STATS = 0x05
+
+# RuntimeConfig field order, followed by one word per run limit menu option.
+PARAMS = ["light_threshold", "dark_threshold", "fluctuation_threshold", "click_hold_us", "auto_run_delay_ms",
+          "ue4_run_delay_ms", "delay_jitter_ms", "measurement_timeout_us", "usb_click_phase_mode",
+          "usb_click_phase_us"]
+STATUS = {0: "OK", 1: "unknown command", 2: "bad length", 3: "invalid value", 4: "busy",
+          5: "not ready (mouse or PC connection missing)", 6: "storage write failed"}
+MODE_CODES = {name.lower(): code for code, name in MODES.items()}
+SNAPSHOT_FORMAT = "<I9f"
+SNAPSHOT_FIELDS = ["runs", "last", "avg", "min", "max", "stddev", "p50", "p90", "p99", "usb_offset"]
+
+
+def param_name(index):
+    return PARAMS[index] if index < len(PARAMS) else f"run_limit_{index - len(PARAMS) + 1}"
+
+
+def encode(frame_type, payload=b""):
+    checksum = (-(frame_type + len(payload) + sum(payload))) & 0xFF
+    return bytes([FRAME_SYNC, frame_type, len(payload)]) + payload + bytes([checksum])
+
+
+def transact(port, frame_type, payload=b"", reply_type=None):
+    """Sends one command and waits for its ACK, plus the 'reply_type' frame if given (its payload is
+    returned). Telemetry frames arriving in between are skipped."""
+    port.write(encode(frame_type, payload))
+    for received_type, body in read_frames(port, stop_on_timeout=True):
+        if received_type == FRAME_TYPE_ACK and body[0] == frame_type:
+            if body[1] != 0:
+                sys.exit(f"Device refused the command: {STATUS.get(body[1], body[1])}")
+            if reply_type is None:
+                return None
+        elif received_type == reply_type:
+            return body
+    sys.exit("No reply from the device (wrong port, or host commands disabled?)")
+
+
+def main():
+    if len(sys.argv) < 3:
+        print("Usage: python ldat_command.py <port> <command> [args]")
+        sys.exit(1)
+
+    import serial  # Imported here so the usage text works without pyserial installed
+
+    port_name, command, args = sys.argv[1], sys.argv[2].lower(), sys.argv[3:]
+    with serial.Serial(port_name, timeout=2) as port:
+        if command == "ping":
+            transact(port, CMD_PING)
+            print("OK")
+        elif command == "get":
+            body = transact(port, CMD_GET_CONFIG, reply_type=FRAME_TYPE_CONFIG)
+            for i, value in enumerate(struct.unpack(f"<{len(body) // 4}I", body)):
+                print(f"{param_name(i)} = {value}")
+        elif command == "set" and len(args) == 2:
+            body = transact(port, CMD_GET_CONFIG, reply_type=FRAME_TYPE_CONFIG)
+            names = [param_name(i) for i in range(len(body) // 4)]
+            if args[0] not in names:
+                sys.exit(f"Unknown parameter '{args[0]}', expected one of: {', '.join(names)}")
+            transact(port, CMD_SET_PARAM, struct.pack("<BI", names.index(args[0]), int(args[1])))
+            print(f"{args[0]} = {args[1]} (not saved, run 'save' to keep it)")
+        elif command == "save":
+            transact(port, CMD_SAVE_CONFIG)
+            print("Settings saved to EEPROM.")
+        elif command == "defaults":
+            transact(port, CMD_LOAD_DEFAULTS)
+            print("Defaults restored (not saved, run 'save' to keep them).")
+        elif command == "start" and len(args) in (1, 2) and args[0].lower() in MODE_CODES:
+            precise = len(args) == 2 and args[1].lower() == "precise"
+            runs = RUN_LIMIT_PRECISION if precise else int(args[1]) if len(args) == 2 else 0
+            transact(port, CMD_START, struct.pack("<BI", MODE_CODES[args[0].lower()], runs))
+            limit = "until precise" if precise else f"{runs} runs" if runs else "unlimited runs"
+            print(f"Started {args[0].upper()}, {limit}.")
+        elif command == "stop":
+            transact(port, CMD_STOP)
+            print("Stopped.")
+        elif command == "baseline":
+            transact(port, CMD_SAVE_BASELINE)
+            print("Session saved as the mode's baseline.")
+        elif command == "stats":
+            body = transact(port, CMD_QUERY_STATS, reply_type=FRAME_TYPE_STATS)
+            mode, complete, _ = struct.unpack_from("<BBH", body)
+            print(f"Mode: {MODES.get(mode, 'none')}{' (complete)' if complete else ''}")
+            size = struct.calcsize(SNAPSHOT_FORMAT)
+            for label, offset in (("primary", 4), ("secondary", 4 + size)):
+                values = struct.unpack_from(SNAPSHOT_FORMAT, body, offset)
+                if values[0]:
+                    print(f"{label}: " + ", ".join(f"{n}={v:.4f}" if isinstance(v, float) else f"{n}={v}"
+                                                   for n, v in zip(SNAPSHOT_FIELDS, values)))
+        else:
+            sys.exit(f"Unknown or incomplete command '{' '.join(sys.argv[2:])}'")
+
+
+if __name__ == "__main__":
+    main()
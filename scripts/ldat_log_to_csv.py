@@ -0,0 +1,112 @@
+"""
+    Open-Source-LDAT - Latency Detection and Analysis Tool
+    Copyright (C) 2025 S4N-T
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later versio
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more detail
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ """
+# Converts the binary .bin session logs written by the firmware into CSV files.
+# Usage: python ldat_log_to_csv.py <log.bin> [more.bin ...]
+# Each input produces a .csv next to it, in the same format as the on-device export.
+#
+# Layout (little-endian), must match LogHeader / LogRecord in src/main.cpp:
+#   Sector 0 (512 bytes): header
+#   Then packed records until end of file.
+
+import os
+import struct
+import sys
+
+SECTOR_SIZE = 512
+MAGIC = b"LDATLOG\x00"
+HEADER_FORMAT = "<8sHHIIBBBBfII"
+# v4 appends the session's sync timeouts, edge timeouts and aborts to the header, v5 the refresh rate,
+# v6 the USB polling rate the firmware was built for and the click hold.
+HEADER_COUNTERS_FORMAT = "<III"
+HEADER_REFRESH_FORMAT = "<f"
+HEADER_USB_FORMAT = "<II"
+# Record layout per log version. v2 added flags and the USB microframe offset, v3 the sensor index,
+# v4 the sync wait and sample count, v5 the frame phase. v6 only changed the header.
+RECORD_FORMATS = {1: "<IIIBBH", 2: "<IIIBBHI12x", 3: "<IIIBBHIB11x", 4: "<IIIBBHIB3xII", 5: "<IIIBBHIBB2xII",
+                  6: "<IIIBBHIBB2xII"}
+FLAG_USB_OFFSET = 0x0001
+FLAG_FRAME_PHASED = 0x0004
+MODES = {1: "AUTO", 2: "DIRECT_AUTO", 3: "AUTO_UE4", 4: "DIRECT_UE4", 5: "DIRECT_MOTION"}
+DIRECTIONS = {0: "B-to-W", 1: "W-to-B"}
+SENSOR_AUDIO = 0xFF  # Click-to-sound runs, logged under the light run of the same click
+SENSOR_AUDIO_NAME = "Audio"
+
+
+def convert(bin_path):
+    with open(bin_path, "rb") as f:
+        sector = f.read(SECTOR_SIZE)
+        header = struct.unpack_from(HEADER_FORMAT, sector)
+        magic, version, record_size, cpu_hz, run_limit, mode, light, dark, _, interval, count, dropped = header
+        if magic != MAGIC:
+            print(f"{bin_path}: not an LDAT log, skipping.")
+            return
+        record_format = RECORD_FORMATS.get(version)
+        if record_format is None or record_size != struct.calcsize(record_format):
+            print(f"{bin_path}: unsupported log version {version}, skipping.")
+            return
+        counters = None
+        if version >= 4:
+            counters = struct.unpack_from(HEADER_COUNTERS_FORMAT, sector, struct.calcsize(HEADER_FORMAT))
+        refresh_hz = 0.0
+        if version >= 5:
+            refresh_offset = struct.calcsize(HEADER_FORMAT) + struct.calcsize(HEADER_COUNTERS_FORMAT)
+            refresh_hz, = struct.unpack_from(HEADER_REFRESH_FORMAT, sector, refresh_offset)
+        poll_rate_hz, click_hold = 0, 0
+        if version >= 6:
+            usb_offset = refresh_offset + struct.calcsize(HEADER_REFRESH_FORMAT)
+            poll_rate_hz, click_hold = struct.unpack_from(HEADER_USB_FORMAT, sector, usb_offset)
+
+        data = f.read()
+
+    # A log that was never closed cleanly has a record count of 0, fall back to the file size.
+    available = len(data) // record_size
+    if count == 0 or count > available:
+        count = available
+
+    csv_path = os.path.splitext(bin_path)[0] + ".csv"
+    with open(csv_path, "w", newline="") as out:
+        out.write("Run,Direction,Latency (ms),Latency (cycles),Timestamp (ms),USB Offset (us),Sensor,"
+                  "Sync Wait (ms),Samples,Frame Phase\n")
+        for i in range(count):
+            fields = struct.unpack_from(record_format, data, i * record_size)
+            timestamp, cycles, run, _, direction, flags = fields[:6]
+            latency_ms = cycles / (cpu_hz / 1000.0)
+            usb_offset = ""
+            if version >= 2 and flags & FLAG_USB_OFFSET:
+                usb_offset = f"{fields[6] / (cpu_hz / 1e6):.3f}"
+            sensor = (SENSOR_AUDIO_NAME if fields[7] == SENSOR_AUDIO else fields[7] + 1) if version >= 3 else 1
+            sync_wait, samples, frame_phase = "", "", ""
+            if version >= 5:
+                sync_wait, samples = f"{fields[9] / (cpu_hz / 1000.0):.3f}", fields[10]
+                if flags & FLAG_FRAME_PHASED:
+                    frame_phase = f"{fields[8] / 256.0:.3f}"
+            elif version == 4:
+                sync_wait, samples = f"{fields[8] / (cpu_hz / 1000.0):.3f}", fields[9]
+            out.write(f"{run},{DIRECTIONS.get(direction, direction)},{latency_ms:.6f},{cycles},{timestamp},{usb_offset},"
+                      f"{sensor},{sync_wait},{samples},{frame_phase}\n")
+
+    print(f"{bin_path}: {MODES.get(mode, mode)}, {count} runs -> {csv_path}"
+          + (f" ({dropped} dropped)" if dropped else "")
+          + (f", timeouts {counters[0]} sync / {counters[1]} edge, {counters[2]} aborted" if counters else "")
+          + (f", refresh {refresh_hz:.2f} Hz" if refresh_hz else "")
+          + (f", USB {poll_rate_hz} Hz, {click_hold} us hold" if poll_rate_hz else ""))
+
+
+if __name__ == "__main__":
+    if len(sys.argv) < 2:
+        print("Usage: python ldat_log_to_csv.py <log.bin> [more.bin ...]")
+        sys.exit(1)
+    for path in sys.argv[1:]:
+        convert(path)
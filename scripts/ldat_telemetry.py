@@ -0,0 +1,113 @@
+"""
+    Open-Source-LDAT - Latency Detection and Analysis Tool
+    Copyright (C) 2025 S4N-T
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later versio
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more detail
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ """
+# Collects the binary telemetry stream from the device's USB serial port and prints one CSV line per run.
+# Usage: python ldat_telemetry.py <port> [output.csv]     (requires pyserial: pip install pyserial)
+#
+# Frame layout, must match the Serial Telemetry section of src/main.cpp:
+#   0xA5, type, length, payload (length bytes), checksum
+#   The byte sum of type..checksum is 0 (mod 256).
+
+import struct
+import sys
+
+FRAME_SYNC = 0xA5
+FRAME_TYPE_SESSION = 0x01
+FRAME_TYPE_RUN = 0x02
+FRAME_TYPE_BENCHMARK = 0x06
+FRAME_TYPE_WAVEFORM = 0x07       # Trace header, its points follow in FRAME_TYPE_WAVEFORM_DATA frames
+FRAME_TYPE_WAVEFORM_DATA = 0x08  # Raw points, see ldat_waveform.py for their layout
+SESSION_FORMAT = "<IIBBBBffII"
+RUN_FORMAT = "<IBBHIIIIIBB2xII"
+BENCHMARK_FORMAT = "<B3xIffffff"
+WAVEFORM_FORMAT = "<IBBHIffffff"
+BENCHMARKS = {0: "Loopback", 1: "Timestamp", 2: "Analog read", 3: "Pin write", 4: "USB report", 5: "Display page"}
+FLAG_USB_OFFSET = 0x0001
+FLAG_FRAME_PHASED = 0x0004
+MODES = {1: "AUTO", 2: "DIRECT_AUTO", 3: "AUTO_UE4", 4: "DIRECT_UE4", 5: "DIRECT_MOTION"}
+DIRECTIONS = {0: "B-to-W", 1: "W-to-B"}
+SENSOR_AUDIO = 0xFF  # Click-to-sound runs, logged under the light run of the same click
+SENSOR_AUDIO_NAME = "Audio"
+CSV_HEADER = ("Mode,Run,Direction,Latency (ms),Samples,Sync Wait (ms),USB Offset (us),Timestamp (ms),Sensor,"
+              "Click Issue (us),Click Hold (ms),Frame Phase")
+
+
+def read_frames(port, stop_on_timeout=False):
+    """Yields (type, payload) for every frame with a valid checksum, resynchronising on errors.
+    With stop_on_timeout the generator ends once a read times out; otherwise it waits indefinitely."""
+    while True:
+        byte = port.read(1)
+        if not byte and stop_on_timeout:
+            return
+        if byte != bytes([FRAME_SYNC]):
+            continue
+        head = port.read(2)
+        if len(head) < 2:
+            continue
+        frame_type, length = head
+        body = port.read(length + 1)
+        if len(body) < length + 1 or (frame_type + length + sum(body)) & 0xFF:
+            continue
+        yield frame_type, body[:length]
+
+
+def main():
+    if len(sys.argv) < 2:
+        print("Usage: python ldat_telemetry.py <port> [output.csv]")
+        sys.exit(1)
+
+    import serial  # Imported here so the usage text works without pyserial installed
+
+    out = open(sys.argv[2], "w", newline="") if len(sys.argv) > 2 else sys.stdout
+    cpu_hz = 600_000_000  # Replaced by the session frame, sent when a mode starts
+    print(CSV_HEADER, file=out, flush=True)
+
+    with serial.Serial(sys.argv[1], timeout=1) as port:
+        for frame_type, payload in read_frames(port):
+            if frame_type == FRAME_TYPE_SESSION and len(payload) == struct.calcsize(SESSION_FORMAT):
+                cpu_hz, run_limit, mode, light, dark, _, interval, refresh_hz, poll_rate_hz, click_hold = \
+                    struct.unpack(SESSION_FORMAT, payload)
+                limit = run_limit if run_limit else "unlimited"
+                refresh = f", refresh {refresh_hz:.2f} Hz" if refresh_hz else ""
+                print(f"# session {MODES.get(mode, mode)}, limit {limit}, thresholds {light}/{dark}, "
+                      f"sample interval {interval:.3f} us{refresh}, USB {poll_rate_hz} Hz, {click_hold} us hold",
+                      file=sys.stderr)
+            elif frame_type == FRAME_TYPE_RUN and len(payload) == struct.calcsize(RUN_FORMAT):
+                run, mode, direction, flags, cycles, samples, sync_cycles, usb_cycles, timestamp, sensor, phase, \
+                    issue_cycles, hold_cycles = struct.unpack(RUN_FORMAT, payload)
+                per_ms = cpu_hz / 1000.0
+                usb = f"{usb_cycles / (per_ms / 1000.0):.3f}" if flags & FLAG_USB_OFFSET else ""
+                frame_phase = f"{phase / 256.0:.3f}" if flags & FLAG_FRAME_PHASED else ""
+                print(f"{MODES.get(mode, mode)},{run},{DIRECTIONS.get(direction, direction)},"
+                      f"{cycles / per_ms:.6f},{samples},{sync_cycles / per_ms:.3f},{usb},{timestamp},{SENSOR_AUDIO_NAME if sensor == SENSOR_AUDIO else sensor + 1},"
+                      f"{issue_cycles / (per_ms / 1000.0):.3f},{hold_cycles / per_ms:.3f},{frame_phase}",
+                      file=out, flush=True)
+            elif frame_type == FRAME_TYPE_BENCHMARK and len(payload) == struct.calcsize(BENCHMARK_FORMAT):
+                bench, count, low, mean, p50, p99, high, std = struct.unpack(BENCHMARK_FORMAT, payload)
+                name = BENCHMARKS.get(bench, bench)
+                if count == 0:
+                    print(f"# benchmark {name}: not measured", file=sys.stderr)
+                else:
+                    print(f"# benchmark {name}: n={count} min {low:.3f} avg {mean:.3f} p50 {p50:.3f} "
+                          f"p99 {p99:.3f} max {high:.3f} sd {std:.3f} us", file=sys.stderr)
+            elif frame_type == FRAME_TYPE_WAVEFORM and len(payload) == struct.calcsize(WAVEFORM_FORMAT):
+                run, mode, direction, _, count, point_us, start, end, rise, settle, overshoot = \
+                    struct.unpack(WAVEFORM_FORMAT, payload)
+                print(f"# waveform {MODES.get(mode, mode)} run {run} {DIRECTIONS.get(direction, direction)}: "
+                      f"{count} points of {point_us:.2f} us, {start:.1f} -> {end:.1f}, rise {rise:.1f} us, "
+                      f"settle {settle:.1f} us, overshoot {overshoot:.1f}%", file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,77 @@
+"""
+    Open-Source-LDAT - Latency Detection and Analysis Tool
+    Copyright (C) 2025 S4N-T
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later versio
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more detail
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ """
+# Converts the .wfm waveform files written next to UE4 session logs into CSV files.
+# Usage: python ldat_waveform.py <log.wfm> [more.wfm ...]
+# Each input produces <name>_summary.csv (one line per trace with the on-device metrics) and
+# <name>_traces.csv (one line per point: run, direction, time relative to the threshold crossing, level).
+#
+# Layout (little-endian), must match WaveformFileHeader / WaveformHeader in src/main.cpp:
+#   File header, then per trace: trace header followed by pointCount uint16 points (ADC counts, 8.8 fixed point).
+
+import os
+import struct
+import sys
+
+MAGIC = b"LDATWFM\x00"
+FILE_HEADER_FORMAT = "<8sHHf"
+TRACE_HEADER_FORMATS = {1: "<IBBHIffffff"}
+MODES = {1: "AUTO", 2: "DIRECT_AUTO", 3: "AUTO_UE4", 4: "DIRECT_UE4", 5: "DIRECT_MOTION"}
+DIRECTIONS = {0: "B-to-W", 1: "W-to-B"}
+
+
+def convert(wfm_path):
+    with open(wfm_path, "rb") as f:
+        data = f.read()
+    if len(data) < struct.calcsize(FILE_HEADER_FORMAT):
+        print(f"{wfm_path}: too short, skipping.")
+        return
+    magic, version, trace_header_size, interval = struct.unpack_from(FILE_HEADER_FORMAT, data)
+    trace_format = TRACE_HEADER_FORMATS.get(version)
+    if magic != MAGIC or trace_format is None or trace_header_size != struct.calcsize(trace_format):
+        print(f"{wfm_path}: not a supported LDAT waveform file, skipping.")
+        return
+
+    base = os.path.splitext(wfm_path)[0]
+    offset = struct.calcsize(FILE_HEADER_FORMAT)
+    traces = 0
+    with open(base + "_summary.csv", "w", newline="") as summary, open(base + "_traces.csv", "w", newline="") as points:
+        summary.write("Mode,Run,Direction,Points,Point (us),Start Level,End Level,Rise (us),Settle (us),"
+                      "Overshoot (%)\n")
+        points.write("Run,Direction,Time (us),Level\n")
+        while offset + trace_header_size <= len(data):
+            run, mode, direction, trigger, count, point_us, start, end, rise, settle, overshoot = \
+                struct.unpack_from(trace_format, data, offset)
+            offset += trace_header_size
+            if offset + count * 2 > len(data):
+                print(f"{wfm_path}: last trace is truncated, ignoring it.")
+                break
+            levels = struct.unpack_from(f"<{count}H", data, offset)
+            offset += count * 2
+
+            name = DIRECTIONS.get(direction, direction)
+            summary.write(f"{MODES.get(mode, mode)},{run},{name},{count},{point_us:.3f},{start:.2f},{end:.2f},"
+                          f"{rise:.1f},{settle:.1f},{overshoot:.2f}\n")
+            points.writelines(f"{run},{name},{(i - trigger) * point_us:.2f},{level / 256.0:.3f}\n"
+                              for i, level in enumerate(levels))
+            traces += 1
+    print(f"{wfm_path}: {traces} traces, sampled every {interval:.3f} us -> {base}_summary.csv, {base}_traces.csv")
+
+
+if __name__ == "__main__":
+    if len(sys.argv) < 2:
+        print("Usage: python ldat_waveform.py <log.wfm> [more.wfm ...]")
+        sys.exit(1)
+    for path in sys.argv[1:]:
+        convert(path)
@@ -16,18 +16,39 @@
 # It works by:
 # 1. Finding the original usb_desc.h in the framework-arduinoteensy package.
 # 2. Creating a backup of the original file (usb_desc.h.bak).
-# 3. Overwriting the original usb_desc.h with our patched 8kHz version.
+# 3. Overwriting MOUSE_INTERVAL in the original usb_desc.h with the value for the environment's
+#    USB_POLL_RATE_HZ (see platformio.ini, 8000 Hz if the environment doesn't set it).
 # 4. After the compilation is complete, it automatically restores the backup.
 # This is a safe and robust way to bypass PlatformIO build system quirks.
 
 import os
+import re
 import shutil
 from SCons.Script import DefaultEnvironment
 
 env = DefaultEnvironment()
 platform = env.PioPlatform()
 
-print("PlatformIO: Running 8kHz patch script (Direct Inject method)...")
+# High Speed interrupt endpoints are polled every 2^(bInterval - 1) microframes of 125 us.
+MOUSE_INTERVALS = {8000: 1, 4000: 2, 2000: 3, 1000: 4}
+
+
+def configured_poll_rate():
+    for define in env.get("CPPDEFINES", []):
+        if isinstance(define, (list, tuple)) and define[0] == "USB_POLL_RATE_HZ":
+            return int(define[1])
+        if isinstance(define, str) and define.startswith("USB_POLL_RATE_HZ="):
+            return int(define.split("=", 1)[1])
+    return 8000
+
+
+poll_rate = configured_poll_rate()
+if poll_rate not in MOUSE_INTERVALS:
+    print(f"Error: USB_POLL_RATE_HZ={poll_rate} is not supported, use one of {sorted(MOUSE_INTERVALS)}.")
+    exit(1)
+mouse_interval = MOUSE_INTERVALS[poll_rate]
+
+print(f"PlatformIO: Running USB polling rate patch script for {poll_rate} Hz (Direct Inject method)...")
 
 # --- Get path to the original header file ---
 framework_dir = platform.get_package_dir("framework-arduinoteensy")
@@ -56,17 +77,15 @@ try:
     with open(original_header_path, "r") as f:
         content = f.read()
 
-    # Define the exact lines to find and replace
-    original_mouse_interval = "#define MOUSE_INTERVAL        2"
-    modified_mouse_interval = "#define MOUSE_INTERVAL        1" # 1 = 8kHz
-
-    if original_mouse_interval in content:
-        content = content.replace(original_mouse_interval, modified_mouse_interval)
+    # Every MOUSE_INTERVAL in the header (one per USB type) gets the interval for the chosen rate.
+    pattern = re.compile(r"#define MOUSE_INTERVAL(\s+)\d+")
+    if pattern.search(content):
+        content = pattern.sub(lambda m: f"#define MOUSE_INTERVAL{m.group(1)}{mouse_interval}", content)
         with open(original_header_path, "w") as f:
             f.write(content)
-        print("PlatformIO: Original usb_desc.h has been patched for 8kHz.")
+        print(f"PlatformIO: Original usb_desc.h has been patched for {poll_rate} Hz (MOUSE_INTERVAL {mouse_interval}).")
     else:
-        print("PlatformIO: MOUSE_INTERVAL not found or already patched. Skipping.")
+        print("PlatformIO: MOUSE_INTERVAL not found. Skipping.")
 
 except IOError as e:
     print(f"Error: Could not read/write original header file: {e}")
@@ -86,5 +105,5 @@ def restore_backup(source, target, env):
     else:
         print("PlatformIO: Warning: Backup file not found, cannot restore.")
 
-# Register the cleanup action to run after building the final firmware file.
-env.AddPostAction(".pio/build/teensy41/firmware.elf", restore_backup)
\ No newline at end of file
+# Register the cleanup action to run after building the final firmware file of this environment.
+env.AddPostAction("$BUILD_DIR/${PROGNAME}.elf", restore_backup)
@@ -25,14 +25,19 @@
 #include <Entropy.h>
 #include <ADC.h> // Teensy-specific ADC library for high-speed analog reads
 #include <SD.h>
-#include <vector>
+#include <EEPROM.h>
+#include <DMAChannel.h>
+#include <IntervalTimer.h>
+#include <algorithm>
 #include "../include/config.h"
 
 // --- Global Objects ---
-Adafruit_SSD1306 display(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, OLED_RESET);
+Adafruit_SSD1306 display(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, OLED_RESET, OLED_I2C_CLOCK_HZ, OLED_I2C_CLOCK_HZ);
 Bounce debouncer = Bounce();
 elapsedMillis ledTimer; // For blinking LED in debug modes
 ADC *adc = new ADC(); // ADC object for optimized analog reads
+DMAChannel sampleDma; // DMA channel streaming ADC1 results into the sample ring
+DMAChannel sampleDmaSecondary; // Streams ADC2 results when interleaved sampling is enabled
 
 // --- State Machine ---
 enum class State {
@@ -45,11 +50,14 @@ enum class State {
     DIRECT_AUTO_MODE,
     AUTO_UE4_APERTURE,
     DIRECT_UE4_APERTURE,
+    DIRECT_MOTION,
     RUNS_COMPLETE,
     ERROR_HALT,
     DEBUG_MOUSE,
     DEBUG_LSENSOR,
-    DEBUG_POLLING_TEST
+    DEBUG_POLLING_TEST,
+    DEBUG_CALIBRATE,
+    DEBUG_BENCHMARK
 };
 State currentState = State::SETUP;
 State previousState = State::SETUP;
@@ -69,6 +77,25 @@ enum class TextAlign {
     RIGHT
 };
 
+// Result code returned to the host for every command
+enum class CommandStatus : uint8_t {
+    OK = 0,
+    UNKNOWN_COMMAND = 1,
+    BAD_LENGTH = 2,
+    INVALID_VALUE = 3,
+    BUSY = 4,          // Not allowed in the current state (e.g. changing settings mid-session)
+    NOT_READY = 5,     // Mode prerequisites missing (mouse or PC connection)
+    STORAGE_ERROR = 6  // EEPROM write did not verify, or the SD card write failed
+};
+
+// Mouse report sent by usbSendSynced()
+enum class UsbAction {
+    PRESS,
+    CLICK,
+    MOVE_FORWARD, // Direct Motion: one step of MOTION_STEP_X / MOTION_STEP_Y
+    MOVE_BACK     // ... and the step back
+};
+
 // Enum for the result of the auto mode measurement function
 enum class AutoMeasureResult {
     SUCCESS,
@@ -76,14 +103,72 @@ enum class AutoMeasureResult {
     ABORT
 };
 
+// --- Runtime Configuration ---
+// Settings the host can change without a reflash, initialised from the config.h defaults.
+// Every field is one 32-bit word so a parameter is addressed by its index (ConfigParam).
+const int RUN_LIMIT_OPTION_COUNT = sizeof(RUN_LIMIT_OPTIONS) / sizeof(RUN_LIMIT_OPTIONS[0]);
+struct RuntimeConfig {
+    int32_t lightThreshold = LIGHT_SENSOR_THRESHOLD;
+    int32_t darkThreshold = DARK_SENSOR_THRESHOLD;
+    int32_t fluctuationThreshold = SENSOR_FLUCTUATION_THRESHOLD;
+    uint32_t clickHoldMicros = MOUSE_CLICK_HOLD_MICROS;
+    uint32_t autoRunDelayMs = AUTO_MODE_RUN_DELAY_MS;
+    uint32_t ue4RunDelayMs = UE4_MODE_RUN_DELAY_MS;
+    int32_t delayJitterMs = MODE_DELAY_JITTER_MS;
+    uint32_t measurementTimeoutMicros = MEASUREMENT_TIMEOUT_MICROS;
+    uint32_t usbClickPhaseMode = USB_CLICK_PHASE_MODE;
+    uint32_t usbClickPhaseMicros = USB_CLICK_PHASE_MICROS;
+    uint32_t runLimitOptions[RUN_LIMIT_OPTION_COUNT];
+
+    RuntimeConfig() {
+        for (int i = 0; i < RUN_LIMIT_OPTION_COUNT; i++) runLimitOptions[i] = RUN_LIMIT_OPTIONS[i];
+    }
+};
+
+// Parameter indices used by the host SET command, in RuntimeConfig field order.
+enum ConfigParam : uint8_t {
+    CFG_LIGHT_THRESHOLD,
+    CFG_DARK_THRESHOLD,
+    CFG_FLUCTUATION_THRESHOLD,
+    CFG_CLICK_HOLD_MICROS,
+    CFG_AUTO_RUN_DELAY_MS,
+    CFG_UE4_RUN_DELAY_MS,
+    CFG_DELAY_JITTER_MS,
+    CFG_MEASUREMENT_TIMEOUT_MICROS,
+    CFG_USB_CLICK_PHASE_MODE,
+    CFG_USB_CLICK_PHASE_MICROS,
+    CFG_RUN_LIMIT_OPTION_FIRST,
+    CFG_PARAM_COUNT = CFG_RUN_LIMIT_OPTION_FIRST + RUN_LIMIT_OPTION_COUNT
+};
+static_assert(sizeof(RuntimeConfig) == CFG_PARAM_COUNT * sizeof(uint32_t), "RuntimeConfig must be a plain array of words");
+
+// Settings persisted in EEPROM. A changed layout (version/size) or a bad checksum falls back to the defaults.
+// The polling rates are stored too: the click hold and USB phase only fit the build they were saved from.
+const int EEPROM_CONFIG_ADDRESS = 0;
+const uint32_t CONFIG_MAGIC = 0x4643444C; // "LDCF"
+const uint16_t CONFIG_VERSION = 2;
+struct StoredConfig {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t size;
+    uint32_t usbPollRateHz;     // USB_POLL_RATE_HZ of the build that saved it
+    uint32_t mousePollRateHz;   // MOUSE_POLL_RATE_HZ of the build that saved it
+    RuntimeConfig config;
+    uint32_t checksum;
+};
+
+RuntimeConfig settings;
+
 // --- Menu Variables ---
 int menuSelection = 0;
-const int menuOptionCount = 4;
+const int menuOptionCount = 5;
 int runLimitMenuSelection = 0;
-const int runLimitMenuOptionCount = sizeof(RUN_LIMIT_OPTIONS) / sizeof(RUN_LIMIT_OPTIONS[0]) + 1;
+const int runLimitMenuOptionCount = RUN_LIMIT_OPTION_COUNT + (ENABLE_PRECISION_RUN_LIMIT ? 2 : 1);
 int debugMenuSelection = 0;
-const int debugMenuOptionCount = 3;
+const int debugMenuOptionCount = 5;
 unsigned long maxRuns = 0;
+bool precisionRunLimit = false;           // "Until +/-" option, maxRuns is then the hard cap
+float sessionPrecisionMicros = INFINITY;  // Widest 95% CI half-width of the session's means, for the footer
 // Scrolling Menu State
 const int MAX_MENU_ITEMS = 3;
 const int MAX_RUN_LIMIT_MENU_ITEMS = 4;
@@ -93,44 +178,617 @@ int debugMenuScrollOffset = 0;
 
 
 // --- Statistics ---
+// P-squared quantile estimator (Jain & Chlamtac): five markers track one quantile in constant memory.
+struct P2Quantile {
+    float quantile;
+    unsigned long count = 0;
+    float height[5] = {0};   // Marker heights, height[2] is the estimate
+    float position[5] = {0}; // Actual marker positions
+    float desired[5] = {0};  // Desired marker positions
+    explicit P2Quantile(float q) : quantile(q) {}
+};
+
 struct LatencyStats {
     unsigned long runCount = 0;
     float lastLatency = 0.0;
     float avgLatency = 0.0;
     float minLatency = 999.0;
     float maxLatency = 0.0;
+    double sumSquaredDiff = 0.0; // Welford M2, variance = M2 / (n - 1)
+    P2Quantile p50{0.50f};
+    P2Quantile p90{0.90f};
+    P2Quantile p99{0.99f};
+    unsigned long usbOffsetCount = 0;
+    float avgUsbOffsetMillis = 0.0; // Mean click-to-poll offset over the Direct mode runs
+    bool percentilesExact = false; // Set once the PSRAM run store has replaced the estimates
+    float exactPercentile[3] = {0}; // p50, p90, p99 in ms
+    float phaseSlotMean[FRAME_PHASE_STRATA] = {0}; // Frame phase scheduling: mean latency (ms) per phase slot
+    unsigned long phaseSlotCount[FRAME_PHASE_STRATA] = {0};
+    uint32_t histogram[BASELINE_HISTOGRAM_BINS] = {0}; // Log-spaced, see latencyHistogramBin()
+};
+// Stats pages in the order a short press cycles through them. FRAME, SENSORS, WAVE and BASE only exist when enabled.
+enum class StatsPage {
+    MAIN,    // Last/avg/min/max
+    TAIL,    // Percentiles and spread
+    PHASE,   // Where the run time goes (PhaseStats)
+    FRAME,   // Detected refresh rate and phase-balanced means
+    SENSORS, // Extra light sensors and sound, Auto modes only
+    WAVE,    // Rise/settle/overshoot of the captured traces, UE4 modes only
+    BASE     // Comparison against the mode's baseline, completed sessions only
 };
+const int MAX_STATS_PAGES = 7;
+int statsPage = 0;      // Position in statsPageList()
 LatencyStats statsAuto;         // Stats for the standard Automatic mode
 LatencyStats statsDirectAuto;   // Stats for the Direct Automatic mode
 LatencyStats statsBtoW;         // Stats for Auto UE4 Black-to-White
 LatencyStats statsWtoB;         // Stats for Auto UE4 White-to-Black
 LatencyStats statsDirectBtoW;   // Stats for Direct UE4 Black-to-White
 LatencyStats statsDirectWtoB;   // Stats for Direct UE4 White-to-Black
+LatencyStats statsMotionBtoW;   // Stats for Direct Motion, step onto the bright side of the edge
+LatencyStats statsMotionWtoB;   // Stats for Direct Motion, step back
+LatencyStats statsExtraSensors[MAX_EXTRA_LIGHT_SENSORS]; // Extra sensors of the running Auto session
+LatencyStats statsAudio;        // Click-to-sound channel of the running Auto session
+
+// Everything one measurement produced, handed from the measurement code to updateStats().
+struct RunResult {
+    uint32_t latencyCycles = 0;   // Click to detected edge
+    uint32_t usbOffsetCycles = 0; // Click to the next host poll of the mouse endpoint
+    bool usbOffsetValid = false;  // Only Direct modes measure the USB offset
+    bool usbPhased = false;       // Click was aligned or randomized against the host poll
+    uint32_t sampleCount = 0;     // Sensor samples from click to edge
+    uint32_t syncWaitCycles = 0;  // Time spent waiting for the screen to settle before the click
+    uint32_t clickIssueCycles = 0; // Click call to the click timestamp (Direct modes: the poll phase wait)
+    uint32_t clickHoldCycles = 0; // Click timestamp to release
+    float framePhase = -1.0f;     // Click position within the frame (0 to 1), -1 = not phase scheduled
+    uint8_t sensor = 0;           // 0 = PIN_LIGHT_SENSOR, N = EXTRA_LIGHT_SENSOR_PINS[N - 1], LOG_SENSOR_AUDIO
+    uint32_t logRunIndex = 0;     // Run number in the log, 0 = the next run of the stats it is added to
+    uint32_t edgeIndex = 0;       // Sample index of the crossing (software detector only)
+};
 
-// --- Latency Data Storage for SD Logging ---
-std::vector<float> latenciesAuto;
-std::vector<float> latenciesDirectAuto;
-std::vector<float> latenciesBtoW;
-std::vector<float> latenciesWtoB;
-std::vector<float> latenciesDirectBtoW;
-std::vector<float> latenciesDirectWtoB;
+// Where the time of a session went, for the PHASE stats page. Shared by both directions of a UE4 session
+// and reset with the session, so a marker that never settles or a click that is never seen shows up here.
+struct PhaseStats {
+    unsigned long runCount = 0;
+    float avgSyncWaitMs = 0.0;
+    float maxSyncWaitMs = 0.0;
+    float avgClickIssueMicros = 0.0;
+    float maxClickIssueMicros = 0.0;
+    float avgClickHoldMs = 0.0;
+    float avgSamples = 0.0;
+    uint32_t maxSamples = 0;
+    unsigned long syncTimeouts = 0;     // The screen never reached the start level
+    unsigned long edgeTimeouts = 0;     // The click produced no crossing within the timeout
+    unsigned long aborts = 0;           // Runs cut short by a button hold
+    unsigned long smartSyncRetries = 0; // UE4 modes: failed smart sync attempts
+};
+PhaseStats phaseStats;
+
+// Click injector policies for the measurement kernel (see "Measurement Kernel" below).
+// press() starts a held click and returns its timestamp, release() ends it, tap() sends a complete
+// timed click, toggle() an untimed one.
+struct PinClick {
+    static const bool IS_DIRECT = false;
+    static uint32_t press(RunResult& run);
+    static void release();
+    static uint32_t tap(RunResult& run);
+    static void toggle();
+};
+struct UsbClick {
+    static const bool IS_DIRECT = true;
+    static uint32_t press(RunResult& run);
+    static void release();
+    static uint32_t tap(RunResult& run);
+    static void toggle();
+};
+// Direct Motion: every "click" is one mouse step, alternately forward and back, so each one toggles
+// the screen under the sensor like a UE4 click. A move has nothing to hold, press() is a tap.
+struct UsbMotion {
+    static const bool IS_DIRECT = true;
+    static uint32_t press(RunResult& run);
+    static void release();
+    static uint32_t tap(RunResult& run);
+    static void toggle();
+};
+static_assert(MOTION_STEP_X >= -127 && MOTION_STEP_X <= 127 && MOTION_STEP_Y >= -127 && MOTION_STEP_Y <= 127,
+              "A mouse report moves at most 127 counts per axis");
+static_assert(MOTION_STEP_X != 0 || MOTION_STEP_Y != 0, "The motion step must move");
+
+// Direction of the screen change a measurement waits for. Values are written to the SD log.
+enum class Transition : uint8_t {
+    DARK_TO_LIGHT = 0, // B-to-W (also every Auto mode run)
+    LIGHT_TO_DARK = 1  // W-to-B
+};
 
 // --- UE4 Mode State ---
 // This tracks whether the next measurement should be Black-to-White or White-to-Black
 bool ue4_isWaitingForWhite = true;
 bool isFirstUe4Run = true;
+bool motionAtStart = true; // Direct Motion: the view is where the session started, the next step goes forward
 bool mouseIsOk = false;
 
 // --- SD Card State ---
 bool sdCardPresent = false;
 bool dataHasBeenSaved = false;
 
+// --- SD Log Format ---
+const size_t LOG_SECTOR_SIZE = 512;
+const char LOG_MAGIC[8] = {'L', 'D', 'A', 'T', 'L', 'O', 'G', 0};
+const uint16_t LOG_FORMAT_VERSION = 6;
+const uint16_t LOG_FLAG_USB_OFFSET = 0x0001;  // usbOffsetCycles holds a measured value
+const uint16_t LOG_FLAG_USB_PHASED = 0x0002;  // The click was issued at a controlled poll phase
+const uint16_t LOG_FLAG_FRAME_PHASED = 0x0004; // The click was scheduled at 'framePhase' within the frame
+const uint8_t LOG_SENSOR_AUDIO = 0xFF;          // LogRecord::sensor of click-to-sound runs
+
+// One measured run, 32 bytes so a sector always holds a whole number of records.
+struct __attribute__((packed)) LogRecord {
+    uint32_t timestampMs;     // millis() when the run finished
+    uint32_t latencyCycles;   // Raw cycle counter ticks from click to edge
+    uint32_t runIndex;        // 1-based run number within its direction
+    uint8_t mode;             // getLogModeCode()
+    uint8_t direction;        // Transition
+    uint16_t flags;           // LOG_FLAG_*
+    uint32_t usbOffsetCycles; // Direct modes: click to the next host poll (a poll-aligned microframe start)
+    uint8_t sensor;           // RunResult::sensor
+    uint8_t framePhase;       // RunResult::framePhase in 1/256 of a frame, valid with LOG_FLAG_FRAME_PHASED
+    uint8_t reservedBytes[2];
+    uint32_t syncWaitCycles;  // Wait for the screen to settle before the click
+    uint32_t sampleCount;     // Sensor samples from click to edge
+};
+static_assert(LOG_SECTOR_SIZE % sizeof(LogRecord) == 0, "Log records must tile a sector exactly");
+
+// Session metadata stored in the first sector of every log.
+struct __attribute__((packed)) LogHeader {
+    char magic[8];              // LOG_MAGIC
+    uint16_t version;           // LOG_FORMAT_VERSION
+    uint16_t recordSize;        // sizeof(LogRecord)
+    uint32_t cpuHz;             // Cycle counter frequency, converts latencyCycles to time
+    uint32_t runLimit;          // 0 = unlimited
+    uint8_t mode;               // getLogModeCode()
+    uint8_t lightThreshold;
+    uint8_t darkThreshold;
+    uint8_t reserved;
+    float sampleIntervalMicros; // Sampling engine interval for this session
+    uint32_t recordCount;       // Filled in on close, 0 if the session never closed cleanly
+    uint32_t droppedRecords;    // Runs that could not be buffered
+    uint32_t syncTimeouts;      // PhaseStats counters, filled in on close like recordCount
+    uint32_t edgeTimeouts;
+    uint32_t aborts;
+    float refreshHz;            // Frame phase scheduling: detected refresh rate, 0 = none
+    uint32_t usbPollRateHz;     // USB_POLL_RATE_HZ the firmware was built for
+    uint32_t clickHoldMicros;   // Mouse switch hold of this session
+};
+
+// --- SD Logger State ---
+FsFile logFile;
+String logFilePath;
+LogHeader logHeader;
+uint8_t logBuffers[2][LOG_SECTOR_SIZE] __attribute__((aligned(4))); // Double buffer, one fills while the other waits for the card
+int logActiveBuffer = 0;          // Buffer currently receiving records
+size_t logBufferFill = 0;         // Bytes used in the active buffer
+bool logBufferPending[2] = {false, false}; // Full and waiting to be written
+int logOldestPending = 0;         // Next buffer to go to the card. Buffers fill and drain in turn, so this is a two-entry FIFO
+uint32_t logRecordCount = 0;
+uint32_t logDroppedRecords = 0;
+int logSectorsSinceSync = 0;
+
+// --- SD Session Index ---
+// Log names come from a session counter kept on the card, so naming costs one small read and write
+// instead of probing names with SD.exists(). Every session also gets a line in the manifest, which a
+// host can read to find and describe all logs without parsing file names.
+const char* SD_INDEX_FILE = "sessions.idx";
+const char* SD_MANIFEST_FILE = "manifest.csv";
+const uint32_t SESSION_INDEX_MAGIC = 0x5844494C; // "LIDX"
+struct SessionIndex {
+    uint32_t magic;
+    uint32_t nextSession;
+};
+const char* FIRMWARE_BUILD = __DATE__ " " __TIME__; // Identifies the firmware in the manifest
+
+// --- Serial Telemetry Format ---
+// Frame: FRAME_SYNC, type, payload length, payload, checksum. The checksum makes the byte sum of
+// everything after the sync byte 0 (mod 256), so a host can resynchronise after a partial read.
+const uint8_t FRAME_SYNC = 0xA5;
+const uint8_t FRAME_TYPE_SESSION = 0x01; // TelemetrySession, sent when a measurement mode starts
+const uint8_t FRAME_TYPE_RUN = 0x02;     // TelemetryRun, sent after every measured run
+const uint8_t FRAME_TYPE_ACK = 0x03;     // CommandAck, reply to every host command
+const uint8_t FRAME_TYPE_CONFIG = 0x04;  // RuntimeConfig, reply to CMD_GET_CONFIG
+const uint8_t FRAME_TYPE_STATS = 0x05;   // StatsReport, reply to CMD_QUERY_STATS
+const uint8_t FRAME_TYPE_BENCHMARK = 0x06; // BenchmarkReport, one per primitive when a benchmark finishes
+const uint8_t FRAME_TYPE_WAVEFORM = 0x07;  // WaveformHeader, once per captured trace
+const uint8_t FRAME_TYPE_WAVEFORM_DATA = 0x08; // WaveformChunk, the trace's points following its header
+
+// Host to device commands use the same framing.
+const uint8_t CMD_PING = 0x80;         // No payload
+const uint8_t CMD_GET_CONFIG = 0x81;   // No payload
+const uint8_t CMD_SET_PARAM = 0x82;    // uint8 ConfigParam, uint32 value
+const uint8_t CMD_SAVE_CONFIG = 0x83;  // No payload, writes the current settings to EEPROM
+const uint8_t CMD_LOAD_DEFAULTS = 0x84; // No payload, restores config.h values (not saved until CMD_SAVE_CONFIG)
+const uint8_t CMD_START = 0x85;        // uint8 mode (getLogModeCode), uint32 run limit (0 = unlimited)
+const uint32_t RUN_LIMIT_PRECISION = 0xFFFFFFFF; // CMD_START run limit for the "Until +/-" option
+const uint8_t CMD_STOP = 0x86;         // No payload, ends the session like the EXIT hold action
+const uint8_t CMD_QUERY_STATS = 0x87;  // No payload
+const uint8_t CMD_SAVE_BASELINE = 0x88; // No payload, saves the completed session as its mode's baseline
+const uint8_t COMMAND_MAX_PAYLOAD = 16;
+
+struct __attribute__((packed)) TelemetrySession {
+    uint32_t cpuHz;             // Converts every *Cycles field to time
+    uint32_t runLimit;          // 0 = unlimited
+    uint8_t mode;               // getLogModeCode()
+    uint8_t lightThreshold;
+    uint8_t darkThreshold;
+    uint8_t reserved;
+    float sampleIntervalMicros;
+    float refreshHz;            // Frame phase scheduling: detected refresh rate, 0 = none
+    uint32_t usbPollRateHz;     // USB_POLL_RATE_HZ the firmware was built for
+    uint32_t clickHoldMicros;
+};
+
+struct __attribute__((packed)) TelemetryRun {
+    uint32_t runIndex;          // 1-based run number within its direction
+    uint8_t mode;               // getLogModeCode()
+    uint8_t direction;          // Transition
+    uint16_t flags;             // LOG_FLAG_*
+    uint32_t latencyCycles;     // Click to edge
+    uint32_t sampleCount;       // Sensor samples from click to edge
+    uint32_t syncWaitCycles;    // Wait for the screen to settle before the click
+    uint32_t usbOffsetCycles;   // Direct modes: click to the next host poll
+    uint32_t timestampMs;       // millis() when the run finished
+    uint8_t sensor;             // RunResult::sensor
+    uint8_t framePhase;         // LogRecord::framePhase
+    uint8_t reserved[2];
+    uint32_t clickIssueCycles;  // RunResult::clickIssueCycles
+    uint32_t clickHoldCycles;   // RunResult::clickHoldCycles
+};
+
+struct __attribute__((packed)) CommandAck {
+    uint8_t command;
+    uint8_t status;             // CommandStatus
+};
+
+struct __attribute__((packed)) StatsSnapshot {
+    uint32_t runCount;
+    float lastMs, avgMs, minMs, maxMs, stdDevMs;
+    float p50Ms, p90Ms, p99Ms;
+    float usbOffsetMs;          // 0 outside Direct modes
+};
+
+struct __attribute__((packed)) StatsReport {
+    uint8_t mode;               // getLogModeCode() of the active or just finished mode, 0 if none
+    uint8_t complete;           // 1 once the run limit was reached
+    uint16_t reserved;
+    StatsSnapshot primary;      // Auto modes: the only stats. UE4 modes: B-to-W
+    StatsSnapshot secondary;    // UE4 modes: W-to-B
+};
+
+struct __attribute__((packed)) BenchmarkReport {
+    uint8_t id;                 // BenchmarkId
+    uint8_t reserved[3];
+    uint32_t count;             // 0 = not measured (no loopback LED, no PC connection)
+    float minMicros, meanMicros, p50Micros, p99Micros, maxMicros, stdDevMicros;
+};
+
+// --- Serial Telemetry State ---
+uint8_t telemetryBuffer[TELEMETRY_BUFFER_SIZE]; // Ring of encoded frames waiting for the USB buffer
+size_t telemetryHead = 0; // Next byte to write
+size_t telemetryTail = 0; // Next byte to send
+uint32_t telemetryDropped = 0;
+uint8_t commandBuffer[COMMAND_MAX_PAYLOAD + 4]; // Partially received host frame
+size_t commandFill = 0;
+
+// --- PSRAM Run Store State ---
+EXTMEM LogRecord runStore[PSRAM_RUN_STORE_CAPACITY]; // Every run of the session, same layout as the SD log
+EXTMEM uint32_t runStoreScratch[PSRAM_RUN_STORE_CAPACITY]; // Latencies of one direction, sorted on completion
+extern "C" uint8_t external_psram_size; // Detected PSRAM size in MB, set by the Teensy startup code
+uint32_t runStoreCapacity = 0; // 0 = no usable PSRAM, the store is disabled
+uint32_t runStoreCount = 0;
+uint32_t runStoreDropped = 0;  // Runs beyond capacity (still in the stats and on SD)
+
+// --- Waveform Capture State ---
+// Every trace is sent as a WaveformHeader followed by its points, each the mean ADC value of
+// WAVEFORM_POINT_MICROS of samples in 8.8 fixed point. The .wfm file starts with a WaveformFileHeader.
+const char WAVEFORM_MAGIC[8] = {'L', 'D', 'A', 'T', 'W', 'F', 'M', 0};
+const uint16_t WAVEFORM_FORMAT_VERSION = 1;
+const float WAVEFORM_MIN_SWING = 4.0f; // ADC counts, smaller steps are too noisy to measure
+const int WAVEFORM_CHUNK_POINTS = 120; // Points per telemetry frame
+static_assert(!(ENABLE_WAVEFORM_CAPTURE && ENABLE_HARDWARE_EDGE_DETECT),
+              "Waveform capture reads the pre-trigger samples from the DMA ring, which the hardware edge detector pauses");
+
+struct __attribute__((packed)) WaveformFileHeader {
+    char magic[8];              // WAVEFORM_MAGIC
+    uint16_t version;           // WAVEFORM_FORMAT_VERSION
+    uint16_t traceHeaderSize;   // sizeof(WaveformHeader)
+    float sampleIntervalMicros;
+};
+
+struct __attribute__((packed)) WaveformHeader {
+    uint32_t runIndex;          // Run of its direction in the stats and the SD log
+    uint8_t mode;               // getLogModeCode()
+    uint8_t direction;          // Transition
+    uint16_t triggerPoint;      // Point holding the threshold crossing
+    uint32_t pointCount;
+    float pointMicros;          // Time covered by one point
+    float startLevel;           // ADC counts before the transition
+    float endLevel;             // ADC counts at the end of the trace
+    float riseMicros;           // 10% to 90% of the swing (falls too)
+    float settleMicros;         // 10% point until the trace stays within WAVEFORM_SETTLE_BAND
+    float overshootPercent;     // Peak past the final level, in % of the swing
+};
+
+struct __attribute__((packed)) WaveformChunk {
+    uint32_t runIndex;
+    uint8_t direction;
+    uint8_t count;              // Points in this frame
+    uint16_t reserved;
+    uint32_t firstPoint;
+    uint16_t points[WAVEFORM_CHUNK_POINTS];
+};
+
+struct WaveformStats {
+    unsigned long count = 0;
+    float avgRiseMicros = 0.0;
+    float avgSettleMicros = 0.0;
+    float avgOvershootPercent = 0.0;
+    float maxOvershootPercent = 0.0;
+};
+
+EXTMEM uint16_t waveformPoints[WAVEFORM_MAX_POINTS];
+bool waveformAvailable = false;        // Enabled and PSRAM fitted
+WaveformStats waveformStats[2];        // Indexed by Transition, reset with the session
+unsigned long waveformRejected = 0;    // Traces lost to the sampler or too flat to measure
+unsigned long waveformSkipped = 0;     // Transitions that came while the previous trace was still going out
+WaveformHeader waveformPending;        // Trace in waveformPoints that is still being sent
+bool waveformPendingSerial = false;
+bool waveformPendingSd = false;
+uint32_t waveformSerialSent = 0;       // Points of the pending trace queued as telemetry so far
+int32_t waveformSdWritten = -1;        // Points written to the .wfm file so far, -1 = header not yet
+FsFile waveformFile;
+
+// --- Baseline State ---
+const char BASELINE_MAGIC[8] = {'L', 'D', 'A', 'T', 'B', 'S', 'L', 0};
+const uint16_t BASELINE_FORMAT_VERSION = 1;
+const char* BASELINE_FILE_PREFIX = "baseline_"; // + getModeString() + ".bsl", in SD_LOG_DIRECTORY
+
+struct __attribute__((packed)) BaselineSummary {
+    uint32_t runCount;
+    float meanMs;
+    float p50Ms;
+    float p99Ms;
+    uint32_t histogram[BASELINE_HISTOGRAM_BINS];
+};
+
+struct __attribute__((packed)) BaselineFile {
+    char magic[8];              // BASELINE_MAGIC
+    uint16_t version;           // BASELINE_FORMAT_VERSION
+    uint8_t mode;               // getLogModeCode()
+    uint8_t directions;         // 1 (Auto modes) or 2 (B-to-W, W-to-B)
+    uint16_t bins;              // BASELINE_HISTOGRAM_BINS, the histogram limits must match too
+    uint16_t reserved;
+    float histogramMinMs;
+    float histogramMaxMs;
+    char name[40];              // Session the baseline came from (its log name)
+    BaselineSummary summary[2];
+};
+
+struct BaselineComparison {
+    bool valid = false;
+    float deltaMeanMs = 0.0;
+    float deltaP99Ms = 0.0;
+    float pValue = 1.0;
+    int verdict = 0;            // -1 = faster than the baseline, 1 = slower, 0 = no significant change
+};
+
+BaselineFile baseline;
+bool baselineLoaded = false;      // 'baseline' holds the completed session's mode baseline
+bool baselineReady = false;       // The completed session has been compared (BASE page available)
+bool baselineIsSession = false;   // The baseline was saved from the shown session itself
+BaselineComparison baselineComparison[2];
+
+// --- Display Renderer State ---
+const int DISPLAY_PAGE_COUNT = SCREEN_HEIGHT / 8; // SSD1306 RAM is organised in 8-pixel-high pages
+// Worst-case time (ms) to push one page: 128 data bytes + addressing, 9 clocks per byte.
+const unsigned long DISPLAY_PAGE_TRANSFER_MS = ((SCREEN_WIDTH + 8) * 9 * 1000UL) / OLED_I2C_CLOCK_HZ + 1;
+uint8_t displayShadow[SCREEN_WIDTH * DISPLAY_PAGE_COUNT]; // What the panel currently shows
+uint8_t displayDirtyPages = 0;   // Bit N set = page N differs from the panel
+// A panel that stops answering (unplugged, bus fault) would keep its pages dirty and take every idle slot.
+// After DISPLAY_PAGE_MAX_FAILURES failed transfers in a row the renderer backs off for DISPLAY_FAULT_BACKOFF_MS
+// and the onboard LED is lit, like at an unanswered boot check, until a page goes through again.
+const uint8_t DISPLAY_PAGE_MAX_FAILURES = 3;
+const unsigned long DISPLAY_FAULT_BACKOFF_MS = 1000;
+uint8_t displayPageFailures = 0;  // Consecutive failed page transfers
+bool displayFault = false;
+elapsedMillis displayFaultTimer;  // Since the renderer backed off
+elapsedMillis statsRefreshTimer; // Rate limits stats redraws during measurement modes
+
+// --- Sampling Engine State ---
+// The DMA writes this ring with modulo addressing, so it must be aligned to its own size.
+// It is kept in DTCM rather than DMAMEM so the CPU can read DMA-written bytes without cache maintenance.
+volatile uint8_t sampleRing[SAMPLE_RING_SIZE] __attribute__((aligned(SAMPLE_RING_SIZE)));
+// ADC2's half of the interleaved stream, same layout.
+volatile uint8_t sampleRingSecondary[ENABLE_INTERLEAVED_SAMPLING ? SAMPLE_RING_SIZE : 1] __attribute__((aligned(SAMPLE_RING_SIZE)));
+// Samples the merged stream can hold before the oldest is overwritten
+const uint32_t SAMPLER_SPAN = ENABLE_INTERLEAVED_SAMPLING ? 2 * SAMPLE_RING_SIZE : SAMPLE_RING_SIZE;
+static_assert(!(ENABLE_INTERLEAVED_SAMPLING && ENABLE_HARDWARE_EDGE_DETECT),
+              "The hardware edge detector pauses ADC1's DMA, which would desynchronize the interleaved stream");
+// Software edge detector filter stage (see EDGE_FILTER_MODE)
+static_assert(EDGE_FILTER_MODE >= 0 && EDGE_FILTER_MODE <= 3, "EDGE_FILTER_MODE must be 0 to 3");
+static_assert(EDGE_FILTER_MODE == 0 || (EDGE_FILTER_WINDOW >= 2 && EDGE_FILTER_WINDOW <= 15), "EDGE_FILTER_WINDOW must be 2 to 15");
+static_assert(EDGE_FILTER_MODE != 1 || (EDGE_FILTER_CONFIRM >= 1 && EDGE_FILTER_CONFIRM <= EDGE_FILTER_WINDOW),
+              "EDGE_FILTER_CONFIRM must be 1 to EDGE_FILTER_WINDOW");
+static_assert(EDGE_FILTER_MODE != 3 || EDGE_FILTER_WINDOW % 2 == 1, "The median filter needs an odd EDGE_FILTER_WINDOW");
+static_assert(!((EDGE_FILTER_MODE != 0 || EDGE_FILTER_HYSTERESIS != 0) && ENABLE_HARDWARE_EDGE_DETECT),
+              "The hardware edge detector compares raw conversions, it can't filter them");
+// Samples the median's edge lags the raw one, for a clean step. The moving average is traced back to the
+// raw crossing inside its window instead (see samplerWaitForCrossing), its lag depends on the step height.
+const float EDGE_FILTER_DELAY_SAMPLES = (EDGE_FILTER_MODE == 3) ? (EDGE_FILTER_WINDOW - 1) / 2.0f : 0.0f;
+uint32_t samplerHead = 0;          // Absolute index of the next sample the DMA will write
+uint32_t samplerLastPos = 0;       // Last observed DMA write offset within the ring
+uint32_t samplerPrimaryHead = 0;   // ADC1 samples written so far (equals samplerHead without interleaving)
+uint32_t samplerSecondaryHead = 0; // ADC2 samples written so far
+uint32_t samplerSecondaryLastPos = 0;
+bool samplerInterleaved = false;   // ADC2 is running and paired with ADC1
+float samplerPrimaryCyclesPerSample = 0.0f; // ADC1's own conversion period
+uint32_t samplerMergeBase = 0;     // Merged index at which the current ADC1/ADC2 pairing started (even)
+uint32_t samplerPrimaryOffset = 0; // ADC1 sample that pairs with merged index 'samplerMergeBase'
+uint32_t samplerSecondaryOffset = 0; // ADC2 sample that pairs with merged index 'samplerMergeBase' + 1
+float samplerPhaseSkew = 0.0f;     // Cycles ADC2 lags behind the ideal half-period offset (0 = perfect)
+uint32_t samplerCursor = 0;        // Absolute index of the next sample to be consumed
+bool samplerOverrun = false;       // Set if the consumer fell a full ring behind the DMA
+float samplerIntervalMicros = 0.0; // Measured time between two consecutive conversions
+float samplerCyclesPerSample = 0.0; // Same interval expressed in CPU cycles
+uint32_t samplerAnchorIndex = 0;   // Sample index captured together with 'samplerAnchorCycles'
+uint32_t samplerAnchorCycles = 0;  // Cycle counter value at the moment of the last sync
+uint32_t samplerRateRefIndex = 0;  // ADC1 sample index the rate refinement counts from
+uint32_t samplerRateRefCycles = 0; // Cycle counter when that sample landed
+uint32_t samplerRateRefMillis = 0; // millis() at the same moment, guards against the cycle counter wrap
+bool samplerRateRefined = false;   // samplerRefineRate() has replaced the boot estimate
+
+// --- Hardware Edge Detection State ---
+// Written by the ADC1 compare interrupt, read by the measurement loop.
+volatile bool hwEdgeLatched = false;
+volatile uint32_t hwEdgeCycles = 0;
+
+// --- Multi-Sensor Scan State ---
+struct ExtraSensorScan {
+    bool detected;
+    int previous;            // Last reading, -1 before the first one
+    uint32_t previousCycles; // When 'previous' was read
+    uint32_t edgeCycles;     // Interpolated threshold crossing
+    uint32_t readingCount;   // Readings of this sensor since the click
+};
+static_assert(EXTRA_LIGHT_SENSOR_COUNT >= 0 && EXTRA_LIGHT_SENSOR_COUNT <= MAX_EXTRA_LIGHT_SENSORS, "Too many extra light sensors");
+static_assert(!(ENABLE_INTERLEAVED_SAMPLING && EXTRA_LIGHT_SENSOR_COUNT > 0),
+              "Extra light sensors are read on ADC2, which interleaved sampling already uses");
+static_assert(!(ENABLE_INTERLEAVED_SAMPLING && ENABLE_AUDIO_CHANNEL),
+              "The audio channel is read on ADC2, which interleaved sampling already uses");
+// The audio channel is scanned like one more extra sensor, in the slot after the light sensors.
+const int SCAN_CHANNEL_COUNT = EXTRA_LIGHT_SENSOR_COUNT + (ENABLE_AUDIO_CHANNEL ? 1 : 0);
+const int AUDIO_SCAN_CHANNEL = EXTRA_LIGHT_SENSOR_COUNT;
+ExtraSensorScan extraSensorScan[MAX_EXTRA_LIGHT_SENSORS + 1];
+bool extraSensorScanActive = false; // Set while an Auto mode click is being timed
+int extraSensorConverting = -1;     // Channel whose conversion is running on ADC2, -1 = none
+
+// --- Refresh Detection State ---
+const uint32_t REFRESH_DETECT_BINS = REFRESH_DETECT_WINDOW_MS * 1000 / REFRESH_DETECT_BIN_MICROS;
+const int REFRESH_FOLD_SLOTS = 32; // Resolution of the folded ripple used to place the frame anchor
+static_assert(FRAME_PHASE_STRATA > 0 && FRAME_PHASE_STRATA <= 32, "FRAME_PHASE_STRATA must be 1 to 32");
+uint16_t refreshBins[ENABLE_FRAME_PHASE_SCHEDULING ? REFRESH_DETECT_BINS : 1]; // Bin means in 1/64 ADC counts
+double refreshPeriodCycles = 0.0;  // Detected frame period, 0 = unknown
+uint32_t refreshAnchorCycles = 0;  // A fixed point of the frame (ripple minimum), advanced to stay recent
+float refreshHz = 0.0f;
+uint8_t framePhaseOrder[FRAME_PHASE_STRATA]; // Slot order of the current round, reshuffled when used up
+int framePhaseNext = 0;
+
+// --- Timebase State ---
+float timebaseCyclesPerMicro = 600.0; // Cycle counter ticks per microsecond, refreshed from F_CPU_ACTUAL
+
+// --- Button Interrupt State ---
+// Written by the pin-change ISR, so abort checks in the timing loops cost two loads instead of a debouncer pass.
+volatile bool buttonIsDown = false;
+volatile uint32_t buttonDownSinceMs = 0;
+
+// --- Run Scheduler State ---
+// The gap between runs is timed by 'runTimer'; loop() keeps serving the host, SD card and display until it expires.
+IntervalTimer runTimer;
+volatile bool runTimerExpired = true; // Set by the timer ISR (or early by adaptive pacing), the next run may start
+elapsedMillis runWaitTimer;           // Time since the pending run was scheduled
+unsigned long runDelayMs = 0;         // Jittered delay of the pending run (adaptive pacing: the upper limit)
+bool runExpectLight = false;          // Adaptive pacing: level the screen has to settle at
+unsigned long runStableTargetMs = 0;  // Adaptive pacing: how long that level must hold
+unsigned long runMinDelayMs = 0;      // Adaptive pacing: earliest start
+elapsedMillis runStableTimer;         // Adaptive pacing: time the screen has held the expected level
+
 // --- Polling Test Variables ---
 const int CIRCLE_RADIUS = 100;
-const float ANGLE_STEP = 0.08f;
-float polltest_angle = 0.0f;
-int polltest_last_x = 0;
-int polltest_last_y = 0;
+const int CIRCLE_STEPS = 80; // One report per step, ~0.08 rad
+
+// libm isn't constexpr, so the table uses a range-reduced Taylor series.
+constexpr double constexprSin(double x) {
+    while (x > M_PI) x -= 2 * M_PI;
+    while (x < -M_PI) x += 2 * M_PI;
+    double term = x, sum = x;
+    for (int i = 1; i < 12; i++) {
+        term *= -x * x / ((2 * i) * (2 * i + 1));
+        sum += term;
+    }
+    return sum;
+}
+
+constexpr int constexprRound(double x) { return x < 0 ? (int)(x - 0.5) : (int)(x + 0.5); }
+
+// One lap of the test circle as per-report deltas, built at compile time. The deltas come from rounded
+// positions, so a lap sums to exactly zero and the cursor never drifts.
+struct CircleDeltaTable {
+    int8_t dx[CIRCLE_STEPS];
+    int8_t dy[CIRCLE_STEPS];
+    constexpr CircleDeltaTable() : dx(), dy() {
+        int lastX = CIRCLE_RADIUS, lastY = 0;
+        for (int i = 0; i < CIRCLE_STEPS; i++) {
+            double angle = 2 * M_PI * (i + 1) / CIRCLE_STEPS;
+            int x = constexprRound(CIRCLE_RADIUS * constexprSin(angle + M_PI / 2));
+            int y = constexprRound(CIRCLE_RADIUS * constexprSin(angle));
+            dx[i] = (int8_t)(x - lastX);
+            dy[i] = (int8_t)(y - lastY);
+            lastX = x;
+            lastY = y;
+        }
+    }
+};
+constexpr CircleDeltaTable circleDeltas;
+
+// Counted over one POLLING_TEST_WINDOW_MS window, then shown. Every usb_mouse_move() call waits for a free
+// transfer, so the transmit queue is full at both ends of the window and each report queued in between is
+// one the host has completed.
+struct PollingTestStats {
+    uint32_t reports = 0;    // usb_mouse_move() calls that queued a report
+    uint32_t failures = 0;   // Calls that timed out waiting for a free transfer
+    uint32_t microframes = 0; // Microframes the bus ran, as counted by the frame index (8 per frame at Full Speed)
+    bool highSpeed = false;
+};
+int polltestStep = 0;
+PollingTestStats polltestCounts;    // Current window
+PollingTestStats polltestResult;    // Last completed window, drawn on screen
+bool polltestHasResult = false;
+uint32_t polltestFrameIndex = 0;    // USB1_FRINDEX at the start of the window
+elapsedMicros polltestWindowTimer;
+
+// --- Threshold Calibration State ---
+// One settled screen level, measured over CALIBRATION_WINDOW_MS.
+struct PlateauLevel {
+    float mean;
+    float stdDev;
+    uint8_t minValue;
+    uint8_t maxValue;
+};
+bool calibrationDone = false;
+bool calibrationOk = false;
+const char* calibrationMessage = "";
+float calibrationFloor = 0.0f;
+float calibrationPeak = 0.0f;
+float calibrationNoise = 0.0f;
+
+// --- Instrument Benchmark State ---
+enum BenchmarkId : uint8_t {
+    BENCH_LOOPBACK,     // Click pin to detected light, through the measurement kernel
+    BENCH_TIMESTAMP,    // Back-to-back timestampNow() pair (the overhead subtracted from the others)
+    BENCH_ANALOG_READ,  // fastAnalogRead() of the light sensor
+    BENCH_PIN_WRITE,    // digitalWriteFast() on the click pin
+    BENCH_USB_REPORT,   // Queueing one mouse report, like Mouse.press() does
+    BENCH_DISPLAY_PAGE, // One renderer page transfer (DISPLAY_PAGE_TRANSFER_MS budgets for this)
+    BENCH_COUNT
+};
+const char* const benchmarkNames[BENCH_COUNT] = {"Loop", "Clock", "ADC", "Pin", "USB", "Page"};
+struct BenchmarkResult {
+    unsigned long count = 0;
+    float minMicros = 0.0f;
+    float maxMicros = 0.0f;
+    float meanMicros = 0.0f;
+    double sumSquaredDiff = 0.0; // Welford M2, same as LatencyStats
+    P2Quantile p50{0.50f};
+    P2Quantile p99{0.99f};
+};
+BenchmarkResult benchmarkResults[BENCH_COUNT];
+bool benchmarkDone = false;
+volatile int benchmarkSink = 0; // Keeps the compiler from dropping benchmarked reads
 
 
 // --- Forward Declarations ---
@@ -143,41 +801,189 @@ void drawHoldActionScreen();
 void drawOperationScreen();
 void drawAutoModeStatsScreen(const char* title, const LatencyStats& stats);
 void drawUe4StatsScreen(const char* title, const LatencyStats& b_to_w_stats, const LatencyStats& w_to_b_stats);
+void drawAutoModeTailScreen(const char* title, const LatencyStats& stats);
+void drawUe4TailScreen(const char* title, const LatencyStats& b_to_w_stats, const LatencyStats& w_to_b_stats);
+void drawSensorsScreen(const char* title, const LatencyStats& mainStats);
+void drawPhaseScreen(const char* title);
+void drawRunCountFooter(unsigned long runCount);
 void drawMouseDebugScreen();
 void drawLightSensorDebugScreen();
 void drawPollingTestScreen();
+void pollingTestUpdate();
 void enterErrorState(const char* errorMessage);
-void updateStats(LatencyStats& stats, std::vector<float>& latencies, unsigned long latencyMicros);
+void rendererMarkDirty();
+bool rendererSendPage(int page);
+bool rendererPump();
+void rendererFlush();
+void buttonIsr();
+bool buttonHoldRequested();
+void runTimerIsr();
+void runSchedulerArm(unsigned long baseDelayMs, bool expectLight = false);
+void runSchedulerReset();
+bool runSchedulerDue();
+unsigned long runSchedulerEarliestStartMs();
+void runSchedulerIdle();
+void updateStats(LatencyStats& stats, Transition direction, const RunResult& run);
+void updatePhaseStats(const RunResult& run);
+void p2Add(P2Quantile& estimator, float value);
+float p2Value(const P2Quantile& estimator);
+float statsStdDev(const LatencyStats& stats);
+float statsMeanConfidenceMicros(const LatencyStats& stats);
+bool runLimitReached(const LatencyStats& stats, const LatencyStats* other);
+bool pollButtonForAbort();
+void handleStatsPageToggle();
+void timebaseBegin();
+uint32_t timestampNow();
+float cyclesToMicros(uint32_t cycles);
+uint32_t microsToCycles(unsigned long micros);
 int fastAnalogRead(uint8_t pin);
+bool samplerBegin();
+void samplerStartSecondary();
+uint32_t samplerRefresh();
+bool samplerWaitForConversion(uint32_t timeoutCycles, uint32_t& outIndex, uint32_t& outCycles);
+void samplerRefineRate();
+uint8_t samplerAt(uint32_t index);
+uint32_t samplerSync();
+bool samplerNext(uint8_t& value);
+int samplerLatest();
+float edgeFilterLevel(uint32_t index);
+template <bool WaitForLight> bool edgeFilterConfirmed(uint32_t index, uint32_t firstIndex, int threshold, uint32_t& outEdge);
+template <bool WaitForLight> bool samplerWaitForCrossing(uint32_t fromIndex, unsigned long timeoutMicros, uint32_t& outIndex, float& outFraction);
+uint32_t samplerIndexToCycles(uint32_t index);
+uint32_t samplerLatencyCycles(uint32_t clickCycles, uint32_t edgeIndex, float fraction = 1.0f);
+void hardwareEdgeIsr();
+uint32_t edgeDetectArm(bool waitForLight);
+template <bool WaitForLight> bool edgeDetectWait(uint32_t clickIndex, uint32_t clickCycles, RunResult& run);
+template <typename Click, bool WaitForLight, bool HoldUntilEdge> bool measureTransition(RunResult& run);
+int extraSensorPin(int channel);
+int extraSensorLightThreshold(int sensor);
+int extraSensorDarkThreshold(int sensor);
+bool extraSensorsDark();
+void extraSensorScanBegin();
+bool extraSensorScanStep();
+void extraSensorScanWaitForLight(uint32_t clickCycles);
+void extraSensorScanFinish(uint32_t clickCycles);
+void updateExtraSensorStats(const RunResult& mainRun, unsigned long mainRunIndex);
 void drawSyncScreen(const char* message, int y = 32);
-SyncResult performSmartSync(bool isDirectMode);
-AutoMeasureResult performAutoModeMeasurement(bool isDirectMode, unsigned long& outLatencyMicros);
+void sendToggleClick(bool isDirectMode);
+template <typename Click> SyncResult performSmartSync();
+bool measurePlateau(PlateauLevel& out);
+void performThresholdCalibration(bool isDirectMode);
+void drawCalibrationScreen();
+float refreshCorrelation(int32_t mean, uint32_t lag);
+double refreshPeakInterpolate(int32_t mean, uint32_t lag);
+bool detectRefreshRate();
+void refreshAdvanceAnchor();
+float framePhaseWait();
+float statsPhaseBalancedMean(const LatencyStats& stats, float& spread);
+int statsPageList(State mode, StatsPage* pages);
+void drawFrameScreen(const char* title, const LatencyStats& first, const LatencyStats* second);
+void benchmarkAdd(BenchmarkResult& result, float micros);
+template <typename Operation> void benchmarkPrimitive(BenchmarkResult& result, int iterations, uint32_t overheadCycles, Operation operation);
+bool benchmarkLoopback();
+void performBenchmark();
+void benchmarkSendReports();
+void formatBenchmarkValue(float micros, char* out, size_t size);
+void drawBenchmarkScreen();
+template <typename Click> AutoMeasureResult performAutoModeMeasurement(RunResult& outRun);
+bool runSchedulerWaiting();
+template <typename Click> void runAutoMode(LatencyStats& stats);
+template <typename Click> void runUe4Mode(LatencyStats& bToWStats, LatencyStats& wToBStats);
+bool usbWaitForPoll(uint32_t timeoutCycles, uint32_t& outCycles);
+bool usbMeasurePollPhase();
+uint32_t usbSendSynced(UsbAction action, RunResult& run);
 void alignText(const char* text, int y = -1, TextAlign align = TextAlign::CENTER);
 bool delayWithJitterAndAbortCheck(unsigned long baseDelayMs);
-bool performMouseCheck();
+void performComponentChecks(bool& sensorOk, bool& mouseOk);
 void displayErrorScreen(const char* title, const char* line1, const char* line2, const char* line3, unsigned long delayMs = 3500);
-void saveDataToSD(State mode, unsigned long run_limit, bool is_partial_save);
+void sdLoggerOpen(State mode, unsigned long run_limit);
+void logWriteHeader();
+void sdLoggerAppend(const LogRecord& record);
+bool sdLoggerPump();
+void sdLoggerFinish();
+void sdLoggerExportCsv(const String& binPath);
+bool telemetrySendFrame(uint8_t type, const void* payload, uint8_t length);
+void telemetrySessionStart(State mode, unsigned long run_limit);
+void telemetrySendRun(const LogRecord& record, const RunResult& run);
+bool telemetryPump();
+size_t telemetryFree();
+void runStoreBegin();
+void runStoreReset();
+void runStoreAppend(const LogRecord& record);
+void runStoreFinalize(LatencyStats& stats, Transition direction);
+void finalizeSessionStats();
+void waveformBegin();
+void waveformReset();
+bool waveformCapture(uint32_t edgeIndex, WaveformHeader& header);
+bool waveformMeasure(WaveformHeader& header);
+void waveformAfterRun(const RunResult& run, Transition direction, unsigned long runIndex);
+void waveformOpenFile(const String& logPath);
+bool waveformPumpSerial();
+bool waveformPumpSd();
+bool waveformPump();
+void drawWaveformScreen(const char* title, unsigned long runCount);
+int latencyHistogramBin(float latencyMillis);
+bool modeStats(State mode, LatencyStats*& first, LatencyStats*& second);
+String baselinePath(State mode);
+bool baselineLoad(State mode);
+bool baselineSave(State mode);
+void baselineCompare(const LatencyStats& current, const BaselineSummary& reference, BaselineComparison& out);
+void baselineCompareSession();
+void baselineSessionComplete();
+bool baselineSaveOffered(State heldFrom);
+void drawBaselineScreen(const char* title, unsigned long runCount);
+float statsPercentile(const LatencyStats& stats, int which);
 void updateScrollOffset(int selection, int& scrollOffset, int optionCount, int maxVisibleItems);
+bool isMeasurementState(State state);
+void beginMeasurementSession();
+void endMeasurementSession(State modeToClear);
+State modeFromLogCode(uint8_t code);
+uint32_t configChecksum(const RuntimeConfig& config);
+bool configParamValid(const RuntimeConfig& config, uint8_t param, uint32_t value);
+void configLoad();
+bool configSave();
+void commandPoll();
+void commandHandle(uint8_t type, const uint8_t* payload, uint8_t length);
+void commandSendAck(uint8_t command, CommandStatus status);
+void commandSendStats();
 
 // --- Component Check Functions ---
-bool performMouseCheck() {
-    // Check for mouse presence by measuring the stability (fluctuation/voltage) on the analog pin.
+// Checks the light sensor (stable reading) and the mouse presence pin (high and stable, see config.h)
+// in the same loop. Both ADCs are already split between them: ADC1 streams the light sensor, the
+// presence pin is read on ADC2.
+void performComponentChecks(bool& sensorOk, bool& mouseOk) {
+    int minLightReading = 1023; // Start high to find the true minimum
+    int maxLightReading = 0;    // Start low to find the true maximum
     int minMouseReading = 1023;
     int maxMouseReading = 0;
+
     elapsedMillis componentCheckTimer;
-    while (componentCheckTimer < FLUC_CHECK_DURATION_MS) {
-        int currentReading = fastAnalogRead(PIN_MOUSE_PRESENCE);
-        if (currentReading < minMouseReading) minMouseReading = currentReading;
-        if (currentReading > maxMouseReading) maxMouseReading = currentReading;
-        delay(10); // Briefly pause to not overwhelm the ADC
+    while (componentCheckTimer < BOOT_CHECK_DURATION_MS) {
+        int lightReading = samplerLatest();
+        int mouseReading = fastAnalogRead(PIN_MOUSE_PRESENCE);
+        minLightReading = min(minLightReading, lightReading);
+        maxLightReading = max(maxLightReading, lightReading);
+        minMouseReading = min(minMouseReading, mouseReading);
+        maxMouseReading = max(maxMouseReading, mouseReading);
+
+        // Pass early once both signals are well inside their limits.
+        if (BOOT_CHECK_EARLY_PASS_MS > 0 && componentCheckTimer >= BOOT_CHECK_EARLY_PASS_MS &&
+            maxLightReading - minLightReading < settings.fluctuationThreshold * BOOT_CHECK_EARLY_PASS_MARGIN &&
+            maxMouseReading - minMouseReading < MOUSE_STABILITY_THRESHOLD_ADC * BOOT_CHECK_EARLY_PASS_MARGIN &&
+            minMouseReading > MOUSE_PRESENCE_MIN_ADC_VALUE) {
+            break;
+        }
+        delayMicroseconds(BOOT_CHECK_SAMPLE_MICROS);
     }
 
+    sensorOk = (maxLightReading - minLightReading) < settings.fluctuationThreshold;
+
     // Condition 1: Is the signal stable (low fluctuation)?
     bool isStable = (maxMouseReading - minMouseReading) < MOUSE_STABILITY_THRESHOLD_ADC;
     // Condition 2: Is the voltage level high enough?
     bool isHighEnough = minMouseReading > MOUSE_PRESENCE_MIN_ADC_VALUE;
     // The check passes only if BOTH conditions are true.
-    return isStable && isHighEnough;
+    mouseOk = isStable && isHighEnough;
 }
 
 // --- Setup Function ---
@@ -185,6 +991,9 @@ void setup() {
     pinMode(PIN_LED_BUILTIN, OUTPUT);
     digitalWrite(PIN_LED_BUILTIN, LOW);
 
+    // Load the host-set runtime settings, or keep the config.h defaults.
+    configLoad();
+
     // Seed the software pseudo-random generator with a true random number.
     randomSeed(Entropy.random());
 
@@ -201,6 +1010,8 @@ void setup() {
 
     debouncer.attach(PIN_BUTTON, INPUT_PULLUP);
     debouncer.interval(25); // Debounce interval in ms
+    // The debouncer drives the menus; the ISR gives the measurement loops an instant abort check.
+    attachInterrupt(digitalPinToInterrupt(PIN_BUTTON), buttonIsr, CHANGE);
 
     // Initialize display
     if (!display.begin(SSD1306_SWITCHCAPVCC, SCREEN_ADDRESS)) {
@@ -210,7 +1021,7 @@ void setup() {
         return; // Halt setup
     }
     display.clearDisplay();
-    display.display();
+    display.display(); // One full push so the panel matches the (zeroed) renderer shadow buffer
 
     // --- ADC Optimization ---
     // The following settings are applied to BOTH ADC controllers (ADC1 and ADC2)
@@ -226,6 +1037,28 @@ void setup() {
     adc->adc1->setConversionSpeed(ADC_CONVERSION_SPEED::VERY_HIGH_SPEED);
     adc->adc1->setSamplingSpeed(ADC_SAMPLING_SPEED::VERY_HIGH_SPEED);
 
+    // --- Timebase & Sampling Engine ---
+    timebaseBegin();
+    // From here on ADC1 belongs to the light sensor stream, all other analog reads go through ADC2.
+    if (!samplerBegin()) {
+        displayErrorScreen("SAMPLER ERROR", "ADC/DMA stream", "did not start.", "Halting...", 0);
+        enterErrorState("Sampler Fail");
+        return; // Halt setup
+    }
+    // A Direct click can leave the ring unread for up to ~3 poll intervals (see usbSendSynced), a full
+    // lap in that time would go unnoticed.
+    if (SAMPLE_RING_SIZE * samplerPrimaryCyclesPerSample <= microsToCycles(3 * USB_POLL_INTERVAL_MICROS)) {
+        displayErrorScreen("SAMPLER ERROR", "Sample ring too", "short for USB poll.", "Halting...", 0);
+        enterErrorState("Sampler Ring");
+        return;
+    }
+
+    // --- PSRAM Run Store ---
+    runStoreBegin();
+
+    // --- PSRAM Waveform Buffer ---
+    waveformBegin();
+
     // --- SD Card Initialization ---
     if (ENABLE_SD_LOGGING) {
         if (SD.begin(BUILTIN_SDCARD)) {
@@ -240,20 +1073,9 @@ void setup() {
     // --- Component Checks ---
     bool monitorOk = true; // If we're here, monitor is working
 
-    // Check light sensor for stability.
-    int minLightReading = 1023; // Start high to find the true minimum
-    int maxLightReading = 0;    // Start low to find the true maximum
-    elapsedMillis componentCheckTimer;
-    while (componentCheckTimer < FLUC_CHECK_DURATION_MS) {
-        int currentReading = fastAnalogRead(PIN_LIGHT_SENSOR);
-        if (currentReading < minLightReading) minLightReading = currentReading;
-        if (currentReading > maxLightReading) maxLightReading = currentReading;
-        delay(10); // Briefly pause to not overwhelm the ADC
-    }
-    bool sensorOk = (maxLightReading - minLightReading) < SENSOR_FLUCTUATION_THRESHOLD;
-
-    // Check for mouse presence using the new helper function.
-    mouseIsOk = performMouseCheck();
+    // Check light sensor stability and mouse presence, both at once.
+    bool sensorOk;
+    performComponentChecks(sensorOk, mouseIsOk);
 
     // Display the setup screen once, so user sees the status
     drawSetupScreen(monitorOk, sensorOk, mouseIsOk, sdCardPresent);
@@ -279,7 +1101,7 @@ void setup() {
         if (debouncer.read() == LOW) {
             if (debouncer.currentDuration() > BUTTON_HOLD_START_MS) {
                 drawHoldActionScreen();
-                display.display();
+                rendererFlush();
             }
         }
         // If the button is NOT being held down...
@@ -321,6 +1143,11 @@ void loop() {
     // Always update the debouncer for any state that might use the button
     debouncer.update();
 
+    // Serve the host between runs: pending commands first, then any queued frames.
+    // The measurement modes pump from runSchedulerIdle() so nothing is sent right before a click.
+    if (ENABLE_HOST_COMMANDS) commandPoll();
+    if (!isMeasurementState(currentState)) telemetryPump();
+
     // Handle blinking LED for debug states
     if (currentState == State::DEBUG_MOUSE || currentState == State::DEBUG_LSENSOR) {
         if (ledTimer > 1000) { // 1 second interval
@@ -329,6 +1156,11 @@ void loop() {
         }
     }
 
+    // A short press on any stats screen flips between the main and tail pages
+    if (isMeasurementState(currentState) || currentState == State::RUNS_COMPLETE) {
+        handleStatsPageToggle();
+    }
+
     switch (currentState) {
         case State::SETUP:
             // Should not be in this state during loop, setup handles its own loop
@@ -392,10 +1224,13 @@ void loop() {
                                          previousState == State::DIRECT_AUTO_MODE ||
                                          previousState == State::AUTO_UE4_APERTURE ||
                                          previousState == State::DIRECT_UE4_APERTURE ||
+                                         previousState == State::DIRECT_MOTION ||
                                          previousState == State::RUNS_COMPLETE);
 
                 // Define which states allow for a "BYPASS" action.
                 bool isBypassValid = (previousState == State::DEBUG_MOUSE);
+                // On the CMP page of a completed session a SELECT-length hold saves the baseline instead of exiting.
+                bool isBaselineSaveValid = baselineSaveOffered(previousState);
 
                 // Action 1: RESET (highest priority)
                 if (heldDuration > BUTTON_RESET_DURATION_MS) {
@@ -416,23 +1251,16 @@ void loop() {
                     menuScrollOffset = 0; // Reset scroll
                     currentState = State::SELECT_MENU; // Proceed to the main menu
                 }
+                // Action 4a: SAVE BASELINE (from the CMP page of a completed run)
+                else if (isBaselineSaveValid && heldDuration > BUTTON_HOLD_DURATION_MS) {
+                    if (!baselineSave(selectedMode)) {
+                        displayErrorScreen("SD CARD ERROR", "Could not save", "the baseline.", "Continuing...");
+                    }
+                    currentState = State::RUNS_COMPLETE;
+                }
                 // Action 4: EXIT (from an active/completed run)
                 else if (isExitClearValid && heldDuration > BUTTON_HOLD_DURATION_MS) {
-                    // Determine which mode's stats to clear.
-                    State modeToClear = (previousState == State::RUNS_COMPLETE) ? selectedMode : previousState;
-                    if (modeToClear == State::AUTO_MODE) {
-                        statsAuto = LatencyStats();
-                    } else if (modeToClear == State::DIRECT_AUTO_MODE) {
-                        statsDirectAuto = LatencyStats();
-                    } else if (modeToClear == State::AUTO_UE4_APERTURE) {
-                        statsBtoW = LatencyStats(); statsWtoB = LatencyStats(); isFirstUe4Run = true;
-                    } else if (modeToClear == State::DIRECT_UE4_APERTURE) {
-                        statsDirectBtoW = LatencyStats(); statsDirectWtoB = LatencyStats(); isFirstUe4Run = true;
-                    }
-                    // Return to the main menu.
-                    menuSelection = 0;
-                    menuScrollOffset = 0; // Reset scroll
-                    currentState = State::SELECT_MENU;
+                    endMeasurementSession((previousState == State::RUNS_COMPLETE) ? selectedMode : previousState);
                 }
                 // Action 5: SELECT (only if contextually valid)
                 else if (isSelectActionValid && heldDuration > BUTTON_HOLD_DURATION_MS) {
@@ -443,7 +1271,8 @@ void loop() {
                         if (menuSelection == 0) selectedMode = State::AUTO_MODE;
                         else if (menuSelection == 1) selectedMode = State::DIRECT_AUTO_MODE;
                         else if (menuSelection == 2) selectedMode = State::AUTO_UE4_APERTURE;
-                        else selectedMode = State::DIRECT_UE4_APERTURE;
+                        else if (menuSelection == 3) selectedMode = State::DIRECT_UE4_APERTURE;
+                        else selectedMode = State::DIRECT_MOTION;
 
                         runLimitMenuSelection = 0; // Reset sub-menu choice for a clean start
                         runLimitMenuScrollOffset = 0; // Reset scroll
@@ -451,15 +1280,19 @@ void loop() {
                     }
                     else if (previousState == State::SELECT_RUN_LIMIT) {
                         // User selected a run limit. Set it and prepare to start the mode.
-                        const int numNumericOptions = sizeof(RUN_LIMIT_OPTIONS) / sizeof(RUN_LIMIT_OPTIONS[0]);
-                        if (runLimitMenuSelection < numNumericOptions) {
-                            maxRuns = RUN_LIMIT_OPTIONS[runLimitMenuSelection];
+                        precisionRunLimit = false;
+                        if (runLimitMenuSelection < RUN_LIMIT_OPTION_COUNT) {
+                            maxRuns = settings.runLimitOptions[runLimitMenuSelection];
+                        } else if (ENABLE_PRECISION_RUN_LIMIT && runLimitMenuSelection == RUN_LIMIT_OPTION_COUNT) {
+                            precisionRunLimit = true;
+                            maxRuns = PRECISION_MAX_RUNS;
                         } else maxRuns = 0;
 
                         bool shouldStartMode = true; // Assume we will start unless a check fails.
 
                         // --- Check for modes requiring a PC connection ---
-                        if (selectedMode == State::DIRECT_AUTO_MODE || selectedMode == State::DIRECT_UE4_APERTURE || selectedMode == State::DEBUG_POLLING_TEST) {
+                        if (selectedMode == State::DIRECT_AUTO_MODE || selectedMode == State::DIRECT_UE4_APERTURE ||
+                            selectedMode == State::DIRECT_MOTION || selectedMode == State::DEBUG_POLLING_TEST) {
                             if (usb_configuration == 0) {
                                 shouldStartMode = false; // Veto the mode start.
                                 displayErrorScreen("CONNECTION ERROR", "This mode requires", "a PC connection.", "Returning to menu...");
@@ -479,28 +1312,7 @@ void loop() {
                         }
 
                         if (shouldStartMode) {
-                            dataHasBeenSaved = false; // Reset save flag for the new run
-                            // Reset stats and data vectors for the selected mode before starting
-                            if (selectedMode == State::AUTO_MODE) {
-                                statsAuto = LatencyStats();
-                                if (ENABLE_SD_LOGGING) latenciesAuto.clear();
-                            } else if (selectedMode == State::DIRECT_AUTO_MODE) {
-                                statsDirectAuto = LatencyStats();
-                                if (ENABLE_SD_LOGGING) latenciesDirectAuto.clear();
-                            } else if (selectedMode == State::AUTO_UE4_APERTURE) {
-                                ue4_isWaitingForWhite = true; // Reset sub-state
-                                isFirstUe4Run = true;
-                                statsBtoW = LatencyStats();   // Clear stats
-                                statsWtoB = LatencyStats();
-                                if (ENABLE_SD_LOGGING) { latenciesBtoW.clear(); latenciesWtoB.clear(); }
-                            } else if (selectedMode == State::DIRECT_UE4_APERTURE) {
-                                 ue4_isWaitingForWhite = true; // Reset sub-state
-                                isFirstUe4Run = true;
-                                statsDirectBtoW = LatencyStats(); // Clear stats
-                                statsDirectWtoB = LatencyStats();
-                                if (ENABLE_SD_LOGGING) { latenciesDirectBtoW.clear(); latenciesDirectWtoB.clear(); }
-                            }
-                            currentState = selectedMode; // Finally, start the analysis mode
+                            beginMeasurementSession(); // Finally, start the analysis mode
                         }
                     }
                      else if (previousState == State::SELECT_DEBUG_MENU) {
@@ -509,6 +1321,17 @@ void loop() {
                             currentState = State::DEBUG_MOUSE;
                         } else if (debugMenuSelection == 1) {
                             currentState = State::DEBUG_LSENSOR;
+                        } else if (debugMenuSelection == 3) {
+                            if (!mouseIsOk && usb_configuration == 0) {
+                                displayErrorScreen("CONNECTION ERROR", "Calibration requires", "a mouse or PC.", "Returning...");
+                                currentState = State::SELECT_DEBUG_MENU; // Go back
+                            } else {
+                                calibrationDone = false;
+                                currentState = State::DEBUG_CALIBRATE;
+                            }
+                        } else if (debugMenuSelection == 4) {
+                            benchmarkDone = false;
+                            currentState = State::DEBUG_BENCHMARK;
                         } else { // debugMenuSelection == 2
                              if (usb_configuration == 0) {
                                 displayErrorScreen("CONNECTION ERROR", "Polling Test requires", "a PC connection.", "Returning...");
@@ -519,12 +1342,14 @@ void loop() {
                                 display.setTextSize(1);
                                 display.setTextColor(SSD1306_WHITE);
                                 drawPollingTestScreen();
-                                display.display();
+                                rendererFlush();
 
                                 // Reset polling test variables before starting.
-                                polltest_angle = 0.0f;
-                                polltest_last_x = 0;
-                                polltest_last_y = 0;
+                                polltestStep = 0;
+                                polltestCounts = PollingTestStats();
+                                polltestHasResult = false;
+                                polltestFrameIndex = USB1_FRINDEX & 0x3FFF;
+                                polltestWindowTimer = 0;
                                 currentState = State::DEBUG_POLLING_TEST;
                             }
                         }
@@ -536,254 +1361,21 @@ void loop() {
                 }
             }
             break;
-        case State::AUTO_MODE: {
-            // Check if run limit has been reached BEFORE performing the next measurement.
-            if (maxRuns > 0 && statsAuto.runCount >= maxRuns) {
-                currentState = State::RUNS_COMPLETE;
-                break;
-            }
-
-            // Check for periodic save in unlimited mode
-            if (maxRuns == 0 && statsAuto.runCount > 0 && (statsAuto.runCount % UNLIMITED_MODE_SAVE_INTERVAL == 0)) {
-                saveDataToSD(currentState, 0, true);
-            }
-            
-            unsigned long latencyResult;
-            AutoMeasureResult result = performAutoModeMeasurement(false, latencyResult); // false for standard auto
-
-            if (result == AutoMeasureResult::SUCCESS) {
-                updateStats(statsAuto, latenciesAuto, latencyResult);
-            } else if (result == AutoMeasureResult::ABORT) {
-                previousState = currentState;
-                currentState = State::HOLD_ACTION;
-                break;
-            }
-            // On TIMEOUT, we just loop and try again.
-
-            if (delayWithJitterAndAbortCheck(AUTO_MODE_RUN_DELAY_MS)) {
-                previousState = currentState;
-                currentState = State::HOLD_ACTION;
-            }
+        case State::AUTO_MODE:
+            runAutoMode<PinClick>(statsAuto);
             break;
-        }
-        case State::DIRECT_AUTO_MODE: {
-            // Check if run limit has been reached BEFORE performing the next measurement.
-            if (maxRuns > 0 && statsDirectAuto.runCount >= maxRuns) {
-                currentState = State::RUNS_COMPLETE;
-                break;
-            }
-
-            // Check for periodic save in unlimited mode
-            if (maxRuns == 0 && statsDirectAuto.runCount > 0 && (statsDirectAuto.runCount % UNLIMITED_MODE_SAVE_INTERVAL == 0)) {
-                saveDataToSD(currentState, 0, true);
-            }
-            
-            unsigned long latencyResult;
-            AutoMeasureResult result = performAutoModeMeasurement(true, latencyResult); // true for direct auto
-
-            if (result == AutoMeasureResult::SUCCESS) {
-                updateStats(statsDirectAuto, latenciesDirectAuto, latencyResult);
-            } else if (result == AutoMeasureResult::ABORT) {
-                previousState = currentState;
-                currentState = State::HOLD_ACTION;
-                break;
-            }
-            // On TIMEOUT, we just loop and try again.
-
-            if (delayWithJitterAndAbortCheck(AUTO_MODE_RUN_DELAY_MS)) {
-                previousState = currentState;
-                currentState = State::HOLD_ACTION;
-            }
+        case State::DIRECT_AUTO_MODE:
+            runAutoMode<UsbClick>(statsDirectAuto);
             break;
-        }
-        case State::AUTO_UE4_APERTURE: {
-            // Check if run limit has been reached.
-            if (maxRuns > 0 && statsBtoW.runCount >= maxRuns) {
-                currentState = State::RUNS_COMPLETE;
-                break;
-            }
-            
-            // Check for periodic save in unlimited mode
-            if (maxRuns == 0 && statsBtoW.runCount > 0 && (statsBtoW.runCount % UNLIMITED_MODE_SAVE_INTERVAL == 0)) {
-                saveDataToSD(currentState, 0, true);
-            }
-
-            // MODIFIED: On the first run, perform sync AND a warm-up cycle.
-            if (isFirstUe4Run) {
-                SyncResult syncResult = performSmartSync(false); // false for AUTO mode click
-
-                if (syncResult == SyncResult::HOLD_ABORT) {
-                    previousState = currentState;
-                    currentState = State::HOLD_ACTION;
-                    break;
-                }
-
-                if (syncResult == SyncResult::SUCCESS) {
-                    // --- WARM-UP CYCLE ---
-                    drawSyncScreen("Warming up...", 32);
-
-                    // Warm-up 1: B-to-W (don't measure)
-                    digitalWriteFast(PIN_SEND_CLICK, HIGH);
-                    delayMicroseconds(MOUSE_CLICK_HOLD_MICROS);
-                    digitalWriteFast(PIN_SEND_CLICK, LOW);
-                    elapsedMicros warmupTimer;
-                    while (fastAnalogRead(PIN_LIGHT_SENSOR) < LIGHT_SENSOR_THRESHOLD && warmupTimer < MEASUREMENT_TIMEOUT_MICROS);
-                    delayWithJitterAndAbortCheck(UE4_MODE_RUN_DELAY_MS);
-
-                    // Warm-up 2: W-to-B (don't measure)
-                    digitalWriteFast(PIN_SEND_CLICK, HIGH);
-                    delayMicroseconds(MOUSE_CLICK_HOLD_MICROS);
-                    digitalWriteFast(PIN_SEND_CLICK, LOW);
-                    warmupTimer = 0;
-                    while (fastAnalogRead(PIN_LIGHT_SENSOR) > DARK_SENSOR_THRESHOLD && warmupTimer < MEASUREMENT_TIMEOUT_MICROS);
-                    delayWithJitterAndAbortCheck(UE4_MODE_RUN_DELAY_MS);
-
-                    isFirstUe4Run = false;         // Sync and warm-up complete.
-                    ue4_isWaitingForWhite = true;  // We ended on DARK, so we expect WHITE next.
-                }
-                // End this loop cycle. The next one will be the first REAL measurement.
-                break;
-            }
-
-            // --- This is the normal measurement logic, which now only runs on a "hot" system ---
-            bool timeoutOccurred = false;
-            elapsedMicros syncTimer;
-            if (ue4_isWaitingForWhite) {
-                while (fastAnalogRead(PIN_LIGHT_SENSOR) > DARK_SENSOR_THRESHOLD) {
-                    if (syncTimer > MEASUREMENT_TIMEOUT_MICROS) { timeoutOccurred = true; break; }
-                }
-            } else {
-                while (fastAnalogRead(PIN_LIGHT_SENSOR) < LIGHT_SENSOR_THRESHOLD) {
-                    if (syncTimer > MEASUREMENT_TIMEOUT_MICROS) { timeoutOccurred = true; break; }
-                }
-            }
-            if (timeoutOccurred) {
-                if(delayWithJitterAndAbortCheck(UE4_MODE_RUN_DELAY_MS)) { previousState = currentState; currentState = State::HOLD_ACTION; }
-                break;
-            }
-
-            timeoutOccurred = false;
-            if (ue4_isWaitingForWhite) {
-                elapsedMicros latencyTimer;
-                digitalWriteFast(PIN_SEND_CLICK, HIGH);
-                delayMicroseconds(MOUSE_CLICK_HOLD_MICROS);
-                digitalWriteFast(PIN_SEND_CLICK, LOW);
-                while (fastAnalogRead(PIN_LIGHT_SENSOR) < LIGHT_SENSOR_THRESHOLD) {
-                    if (latencyTimer > MEASUREMENT_TIMEOUT_MICROS) { timeoutOccurred = true; break; }
-                }
-                if (!timeoutOccurred) {
-                    updateStats(statsBtoW, latenciesBtoW, latencyTimer);
-                    ue4_isWaitingForWhite = false;
-                }
-            } else {
-                elapsedMicros latencyTimer;
-                digitalWriteFast(PIN_SEND_CLICK, HIGH);
-                delayMicroseconds(MOUSE_CLICK_HOLD_MICROS);
-                digitalWriteFast(PIN_SEND_CLICK, LOW);
-                while (fastAnalogRead(PIN_LIGHT_SENSOR) > DARK_SENSOR_THRESHOLD) {
-                    if (latencyTimer > MEASUREMENT_TIMEOUT_MICROS) { timeoutOccurred = true; break; }
-                }
-                if (!timeoutOccurred) {
-                    updateStats(statsWtoB, latenciesWtoB, latencyTimer);
-                    ue4_isWaitingForWhite = true;
-                }
-            }
-            if (delayWithJitterAndAbortCheck(UE4_MODE_RUN_DELAY_MS)) {
-                previousState = currentState;
-                currentState = State::HOLD_ACTION;
-            }
+        case State::AUTO_UE4_APERTURE:
+            runUe4Mode<PinClick>(statsBtoW, statsWtoB);
             break;
-        }
-        case State::DIRECT_UE4_APERTURE: {
-            if (maxRuns > 0 && statsDirectBtoW.runCount >= maxRuns) {
-                currentState = State::RUNS_COMPLETE;
-                break;
-            }
-
-            // Check for periodic save in unlimited mode
-            if (maxRuns == 0 && statsDirectBtoW.runCount > 0 && (statsDirectBtoW.runCount % UNLIMITED_MODE_SAVE_INTERVAL == 0)) {
-                saveDataToSD(currentState, 0, true);
-            }
-
-            // On the first run, perform sync AND a warm-up cycle.
-            if (isFirstUe4Run) {
-                SyncResult syncResult = performSmartSync(true); // true for DIRECT mode click
-
-                if (syncResult == SyncResult::HOLD_ABORT) {
-                    previousState = currentState;
-                    currentState = State::HOLD_ACTION;
-                    break;
-                }
-
-                if (syncResult == SyncResult::SUCCESS) {
-                    // --- WARM-UP CYCLE ---
-                    drawSyncScreen("Warming up...", 32);
-
-                    // Warm-up 1: B-to-W (don't measure)
-                    Mouse.click(MOUSE_LEFT);
-                    elapsedMicros warmupTimer;
-                    while (fastAnalogRead(PIN_LIGHT_SENSOR) < LIGHT_SENSOR_THRESHOLD && warmupTimer < MEASUREMENT_TIMEOUT_MICROS);
-                    delayWithJitterAndAbortCheck(UE4_MODE_RUN_DELAY_MS);
-
-                    // Warm-up 2: W-to-B (don't measure)
-                    Mouse.click(MOUSE_LEFT);
-                    warmupTimer = 0;
-                    while (fastAnalogRead(PIN_LIGHT_SENSOR) > DARK_SENSOR_THRESHOLD && warmupTimer < MEASUREMENT_TIMEOUT_MICROS);
-                    delayWithJitterAndAbortCheck(UE4_MODE_RUN_DELAY_MS);
-
-                    isFirstUe4Run = false;         // Sync and warm-up complete.
-                    ue4_isWaitingForWhite = true;  // We ended on DARK, so we expect WHITE next.
-                }
-                // End this loop cycle. The next one will be the first REAL measurement.
-                break;
-            }
-
-            // --- Normal measurement logic ---
-            bool timeoutOccurred = false;
-            elapsedMicros syncTimer;
-            if (ue4_isWaitingForWhite) {
-                while (fastAnalogRead(PIN_LIGHT_SENSOR) > DARK_SENSOR_THRESHOLD) {
-                    if (syncTimer > MEASUREMENT_TIMEOUT_MICROS) { timeoutOccurred = true; break; }
-                }
-            } else {
-                while (fastAnalogRead(PIN_LIGHT_SENSOR) < LIGHT_SENSOR_THRESHOLD) {
-                    if (syncTimer > MEASUREMENT_TIMEOUT_MICROS) { timeoutOccurred = true; break; }
-                }
-            }
-            if (timeoutOccurred) {
-                if (delayWithJitterAndAbortCheck(UE4_MODE_RUN_DELAY_MS)) { previousState = currentState; currentState = State::HOLD_ACTION; }
-                break;
-            }
-
-            timeoutOccurred = false;
-            if (ue4_isWaitingForWhite) {
-                elapsedMicros latencyTimer;
-                Mouse.click(MOUSE_LEFT);
-                while (fastAnalogRead(PIN_LIGHT_SENSOR) < LIGHT_SENSOR_THRESHOLD) {
-                    if (latencyTimer > MEASUREMENT_TIMEOUT_MICROS) { timeoutOccurred = true; break; }
-                }
-                if (!timeoutOccurred) {
-                    updateStats(statsDirectBtoW, latenciesDirectBtoW, latencyTimer);
-                    ue4_isWaitingForWhite = false;
-                }
-            } else {
-                elapsedMicros latencyTimer;
-                Mouse.click(MOUSE_LEFT);
-                while (fastAnalogRead(PIN_LIGHT_SENSOR) > DARK_SENSOR_THRESHOLD) {
-                    if (latencyTimer > MEASUREMENT_TIMEOUT_MICROS) { timeoutOccurred = true; break; }
-                }
-                if (!timeoutOccurred) {
-                    updateStats(statsDirectWtoB, latenciesDirectWtoB, latencyTimer);
-                    ue4_isWaitingForWhite = true;
-                }
-            }
-
-            if (delayWithJitterAndAbortCheck(UE4_MODE_RUN_DELAY_MS)) {
-                previousState = currentState;
-                currentState = State::HOLD_ACTION;
-            }
+        case State::DIRECT_UE4_APERTURE:
+            runUe4Mode<UsbClick>(statsDirectBtoW, statsDirectWtoB);
+            break;
+        case State::DIRECT_MOTION:
+            runUe4Mode<UsbMotion>(statsMotionBtoW, statsMotionWtoB);
             break;
-        }
         case State::DEBUG_POLLING_TEST: {
             // Check for the exit condition: a button click.
             if (debouncer.rose()) {
@@ -793,37 +1385,49 @@ void loop() {
                 break;
             }
 
-            // Calculate the new desired cursor position on a circle.
-            int current_x = (int)(CIRCLE_RADIUS * cos(polltest_angle));
-            int current_y = (int)(CIRCLE_RADIUS * sin(polltest_angle));
-
-            // Calculate the delta (change) from the last position.
-            int dx = current_x - polltest_last_x;
-            int dy = current_y - polltest_last_y;
-
             // We call usb_mouse_move() on EVERY loop iteration, without checking if
             // movement occurred. This is the key to achieving a true 8kHz polling rate.
-            usb_mouse_move(dx, dy, 0, 0);
-
-            // Store the current position to calculate the next delta.
-            polltest_last_x = current_x;
-            polltest_last_y = current_y;
+            // Once the transmit buffers are full, each call waits for the host to take one.
+            if (usb_mouse_move(circleDeltas.dx[polltestStep], circleDeltas.dy[polltestStep], 0, 0) == 0) {
+                polltestCounts.reports++;
+            } else polltestCounts.failures++;
+            polltestStep = (polltestStep + 1) % CIRCLE_STEPS;
 
-            // Increment the angle for the next point on the circle.
-            polltest_angle += ANGLE_STEP;
-
-            // Wrap the angle around to prevent it from losing precision.
-            if (polltest_angle > TWO_PI) {
-                polltest_angle -= TWO_PI;
-            }
+            pollingTestUpdate();
             break;
         }
+        case State::DEBUG_CALIBRATE:
+            // Runs once on entry (blocking), then shows the result until a click.
+            if (!calibrationDone) {
+                performThresholdCalibration(!mouseIsOk); // Fall back to USB clicks without a mouse
+                break;
+            }
+            if (debouncer.rose()) {
+                debugMenuSelection = 0;
+                debugMenuScrollOffset = 0;
+                currentState = State::SELECT_DEBUG_MENU;
+            }
+            break;
+        case State::DEBUG_BENCHMARK:
+            // Same flow as the calibration: run once on entry, then show the results until a click.
+            if (!benchmarkDone) {
+                performBenchmark();
+                break;
+            }
+            if (debouncer.rose()) {
+                debugMenuSelection = 0;
+                debugMenuScrollOffset = 0;
+                currentState = State::SELECT_DEBUG_MENU;
+            }
+            break;
         case State::RUNS_COMPLETE:
             // This is a halt state. The display will freeze on the final statistics.
             
-            // Save data on completion of a limited run. This runs only once.
+            // Finalize the session log on completion of a limited run. This runs only once.
             if (!dataHasBeenSaved && maxRuns > 0) {
-                saveDataToSD(selectedMode, maxRuns, false);
+                sdLoggerFinish();
+                finalizeSessionStats();
+                baselineSessionComplete();
                 dataHasBeenSaved = true;
             }
 
@@ -847,22 +1451,136 @@ void loop() {
 // Replaces delay() with a non-blocking version that checks for an abort signal (button hold).
 // Returns true if an abort was detected, false otherwise.
 bool delayWithJitterAndAbortCheck(unsigned long baseDelayMs) {
-    long jitter = random(-MODE_DELAY_JITTER_MS, MODE_DELAY_JITTER_MS + 1);
+    long jitter = random(-settings.delayJitterMs, settings.delayJitterMs + 1);
     long finalDelay = baseDelayMs + jitter;
 
     if (finalDelay <= 0) return false;
 
     elapsedMillis delayTimer;
     while (delayTimer < (unsigned long)finalDelay) {
-        debouncer.update();
-        if (debouncer.read() == LOW && debouncer.currentDuration() > BUTTON_HOLD_START_MS) {
+        if (pollButtonForAbort()) {
             return true; // Abort signal detected
         }
-        delay(1); // Yield for a moment, allows other processes to run.
+        // Use the idle time to push changed display pages, one page per pass so the button stays
+        // responsive. Stop early enough that a transfer never spills into the next measurement.
+        unsigned long remaining = (unsigned long)finalDelay - delayTimer;
+        if (remaining <= DISPLAY_PAGE_TRANSFER_MS || (!telemetryPump() && !sdLoggerPump() && !rendererPump())) {
+            delay(1); // Yield for a moment, allows other processes to run.
+        }
     }
     return false; // No abort
 }
 
+// Button poll for the blocking waits. A short press flips the stats page, a hold requests an abort.
+bool pollButtonForAbort() {
+    debouncer.update();
+    handleStatsPageToggle();
+    return buttonHoldRequested();
+}
+
+// Tracks the raw pin on every edge. Contact bounce only moves 'buttonDownSinceMs' by a few ms.
+FASTRUN void buttonIsr() {
+    bool down = digitalReadFast(PIN_BUTTON) == LOW;
+    if (down && !buttonIsDown) buttonDownSinceMs = millis();
+    buttonIsDown = down;
+}
+
+// True once the button has been held past BUTTON_HOLD_START_MS. Cheap enough for the sync spin loops.
+FASTRUN bool buttonHoldRequested() {
+    return buttonIsDown && millis() - buttonDownSinceMs > BUTTON_HOLD_START_MS;
+}
+
+// Call right after debouncer.update() on the stats screens.
+void handleStatsPageToggle() {
+    if (debouncer.rose() && debouncer.previousDuration() < BUTTON_HOLD_START_MS) {
+        State shownMode = (currentState == State::RUNS_COMPLETE) ? selectedMode : currentState;
+        StatsPage pages[MAX_STATS_PAGES];
+        statsPage = (statsPage + 1) % statsPageList(shownMode, pages);
+        statsRefreshTimer = STATS_REFRESH_INTERVAL_MS; // Skip the rate limit so the new page shows at once
+    }
+}
+
+// Fills 'pages' with the stats pages available for 'mode' and returns how many there are.
+int statsPageList(State mode, StatsPage* pages) {
+    int count = 0;
+    pages[count++] = StatsPage::MAIN;
+    pages[count++] = StatsPage::TAIL;
+    pages[count++] = StatsPage::PHASE;
+    if (ENABLE_FRAME_PHASE_SCHEDULING) pages[count++] = StatsPage::FRAME;
+    if (SCAN_CHANNEL_COUNT > 0 && (mode == State::AUTO_MODE || mode == State::DIRECT_AUTO_MODE)) {
+        pages[count++] = StatsPage::SENSORS;
+    }
+    if (waveformAvailable && (mode == State::AUTO_UE4_APERTURE || mode == State::DIRECT_UE4_APERTURE ||
+                              mode == State::DIRECT_MOTION)) {
+        pages[count++] = StatsPage::WAVE;
+    }
+    if (ENABLE_BASELINE_COMPARISON && baselineReady) pages[count++] = StatsPage::BASE;
+    return count;
+}
+
+// --- Run Scheduler ---
+// One-shot: stops itself, so the next run is only armed again after the current one.
+FASTRUN void runTimerIsr() {
+    runTimer.end();
+    runTimerExpired = true;
+}
+
+// Schedules the next run 'baseDelayMs' (plus jitter) from now. With adaptive pacing the delay is the upper
+// limit and runSchedulerDue() starts the run as soon as the screen has settled at 'expectLight'.
+void runSchedulerArm(unsigned long baseDelayMs, bool expectLight) {
+    long delayMs = baseDelayMs;
+    if (ENABLE_ADAPTIVE_PACING) {
+        runExpectLight = expectLight;
+        runStableTargetMs = ADAPTIVE_SETTLE_MS + random(ADAPTIVE_JITTER_MS + 1);
+        runMinDelayMs = ENABLE_FAST_SOAK ? 0 : min(ADAPTIVE_MIN_DELAY_MS, baseDelayMs);
+        runStableTimer = 0;
+    } else {
+        delayMs += random(-settings.delayJitterMs, settings.delayJitterMs + 1);
+    }
+
+    runTimer.end();
+    runWaitTimer = 0;
+    runDelayMs = delayMs > 0 ? delayMs : 0;
+    runTimerExpired = (runDelayMs == 0);
+    if (!runTimerExpired) runTimer.begin(runTimerIsr, (unsigned int)(runDelayMs * 1000));
+}
+
+// Drops any pending delay, the next measurement pass starts at once.
+void runSchedulerReset() {
+    runTimer.end();
+    runTimerExpired = true;
+}
+
+// True once the pending run may start. Adaptive pacing ends the wait early when the screen has settled.
+// If it never settles the full delay is used and the run's own sync step takes over.
+bool runSchedulerDue() {
+    if (ENABLE_ADAPTIVE_PACING && !runTimerExpired) {
+        int level = samplerLatest();
+        bool settled = runExpectLight ? (level >= settings.lightThreshold) : (level <= settings.darkThreshold);
+        if (!settled) runStableTimer = 0;
+        if (runStableTimer >= runStableTargetMs && runWaitTimer >= runMinDelayMs) runSchedulerReset();
+    }
+    return runTimerExpired;
+}
+
+// Lower bound on the time until the pending run can start.
+unsigned long runSchedulerEarliestStartMs() {
+    unsigned long waited = runWaitTimer;
+    unsigned long untilDeadline = runDelayMs - min(waited, runDelayMs);
+    if (!ENABLE_ADAPTIVE_PACING) return untilDeadline;
+    unsigned long untilStable = runStableTargetMs - min((unsigned long)runStableTimer, runStableTargetMs);
+    unsigned long untilMin = runMinDelayMs - min(waited, runMinDelayMs);
+    return min(untilDeadline, max(untilStable, untilMin));
+}
+
+// Idle work while a run is pending: the changed display pages, SD writes and telemetry, one unit per pass
+// so the loop stays responsive. Stops early enough that a transfer never spills into the next measurement.
+void runSchedulerIdle() {
+    if (ENABLE_FRAME_PHASE_SCHEDULING) refreshAdvanceAnchor();
+    samplerRefineRate();
+    if (runSchedulerEarliestStartMs() <= DISPLAY_PAGE_TRANSFER_MS) return;
+    if (!telemetryPump() && !sdLoggerPump() && !waveformPump()) rendererPump();
+}
 
 // Helper function to display a full-screen status message during the sync process.
 void drawSyncScreen(const char* message, int y) {
@@ -872,73 +1590,122 @@ void drawSyncScreen(const char* message, int y) {
     alignText("SYNCHRONIZING", 0);
     display.drawLine(0, 8, SCREEN_WIDTH - 1, 8, SSD1306_WHITE);
     alignText(message, y);
-    display.display();
+    rendererFlush();
 }
 
-// Measurement logic for both standard and direct auto modes
-AutoMeasureResult performAutoModeMeasurement(bool isDirectMode, unsigned long& outLatencyMicros) {
-    // --- SYNC STEP ---
-    // We wait until the screen has been continuously dark.
-    elapsedMicros overallSyncTimer;
-    while (fastAnalogRead(PIN_LIGHT_SENSOR) > DARK_SENSOR_THRESHOLD) {
-        if (overallSyncTimer > MEASUREMENT_TIMEOUT_MICROS) {
-            return AutoMeasureResult::TIMEOUT;
-        }
-        debouncer.update();
-        if (debouncer.read() == LOW && debouncer.currentDuration() > BUTTON_HOLD_START_MS) {
-            return AutoMeasureResult::ABORT;
+// --- USB Poll Timing ---
+// A high-speed host polls the mouse endpoint once every USB_POLL_INTERVAL_MICROS, so a report queued at
+// a random moment waits up to that long before it can leave. The controller's frame index register
+// advances at every 125 us microframe. At 8 kHz every microframe carries a poll, below that the host
+// picks which of the USB_POLL_MICROFRAMES microframes of each interval it uses. That phase is measured at
+// the start of every Direct session (usbMeasurePollPhase); until it is known, no offset is recorded and
+// the click is not phased. Spinning on the index gives the poll edge without touching the core's USB
+// interrupt. The offset from the click to the next poll edge is recorded for every Direct run.
+// The spins keep the sample ring's head current: at 1 kHz a click can take ~3 poll intervals.
+static_assert(USB_POLL_MICROFRAMES <= 8, "The poll phase table holds at most one frame");
+const int USB_POLL_PHASE_PROBES = 8;    // Reports timed by usbMeasurePollPhase()
+uint32_t usbPollPhase = 0;              // Microframe index modulo USB_POLL_MICROFRAMES of the host's polls
+bool usbPollPhaseKnown = USB_POLL_MICROFRAMES == 1;
+
+// Spins until the USB frame index moves to the next microframe the host polls in. Returns false if none
+// arrived in time (host not connected or suspended).
+FASTRUN bool usbWaitForPoll(uint32_t timeoutCycles, uint32_t& outCycles) {
+    uint32_t startIndex = USB1_FRINDEX & 0x3FFF;
+    uint32_t start = timestampNow();
+    while (true) {
+        // The 14-bit index wraps at a multiple of 8, so the phase holds across the wrap.
+        uint32_t index = USB1_FRINDEX & 0x3FFF;
+        if (index != startIndex && (index + USB_POLL_MICROFRAMES - usbPollPhase) % USB_POLL_MICROFRAMES == 0) break;
+        if (timestampNow() - start > timeoutCycles) return false;
+        samplerRefresh();
+    }
+    outCycles = timestampNow();
+    return true;
+}
+
+// Finds the microframe phase of the host's polls by sending reports without motion and noting the
+// microframe in which the controller retires each one (its ENDPTSTAT transmit bit clears once the host
+// has taken the report). The most frequent phase wins if it has a majority. Returns usbPollPhaseKnown.
+bool usbMeasurePollPhase() {
+    if (USB_POLL_MICROFRAMES == 1) return usbPollPhaseKnown = true;
+    usbPollPhaseKnown = false;
+    int votes[USB_POLL_MICROFRAMES] = {0};
+    const uint32_t readyMask = 1UL << (16 + MOUSE_ENDPOINT);
+    const uint32_t timeoutCycles = microsToCycles(USB_POLL_INTERVAL_MICROS * 4);
+    for (int i = 0; i < USB_POLL_PHASE_PROBES; i++) {
+        usb_mouse_move(0, 0, 0, 0);
+        uint32_t start = timestampNow();
+        bool primed = false;
+        while (timestampNow() - start < timeoutCycles) {
+            bool ready = (USB1_ENDPTSTAT & readyMask) != 0;
+            if (ready) primed = true;
+            else if (primed) break; // Retired in this microframe
         }
-        delayMicroseconds(50);
+        uint32_t index = USB1_FRINDEX & 0x3FFF;
+        if (primed && !(USB1_ENDPTSTAT & readyMask)) votes[index % USB_POLL_MICROFRAMES]++;
+        delayMicroseconds(USB_POLL_INTERVAL_MICROS / 3); // Next report lands at another point of the interval
     }
-    
-    // --- MEASUREMENT STEP ---
-    bool timeoutOccurred = false;
-    elapsedMicros latencyTimer;
-    
-    // 1. Send the click signal (either via pin or USB) and start the timer.
-    if (isDirectMode) {
+    int best = 0;
+    for (uint32_t phase = 1; phase < USB_POLL_MICROFRAMES; phase++) {
+        if (votes[phase] > votes[best]) best = phase;
+    }
+    if (votes[best] * 2 <= USB_POLL_PHASE_PROBES) return false;
+    usbPollPhase = best;
+    return usbPollPhaseKnown = true;
+}
+
+// Issues a Direct mode mouse report (click or motion step) timed according to settings.usbClickPhaseMode and returns the click
+// timestamp. The click-to-next-poll offset is stored in 'run'.
+FASTRUN uint32_t usbSendSynced(UsbAction action, RunResult& run) {
+    uint32_t timeoutCycles = microsToCycles(USB_POLL_INTERVAL_MICROS * 2);
+    uint32_t edgeCycles;
+
+    run.usbPhased = false;
+    if (settings.usbClickPhaseMode != 0 && usbPollPhaseKnown && usbWaitForPoll(timeoutCycles, edgeCycles)) {
+        uint32_t phaseMicros = (settings.usbClickPhaseMode == 1) ? settings.usbClickPhaseMicros % USB_POLL_INTERVAL_MICROS
+                                                           : random(USB_POLL_INTERVAL_MICROS);
+        uint32_t phaseCycles = microsToCycles(phaseMicros);
+        while (timestampNow() - edgeCycles < phaseCycles) samplerRefresh();
+        run.usbPhased = true;
+    }
+
+    uint32_t clickCycles = timestampNow();
+    if (action == UsbAction::PRESS) {
         Mouse.press(MOUSE_LEFT);
+    } else if (action == UsbAction::CLICK) {
+        Mouse.click(MOUSE_LEFT);
+    } else if (action == UsbAction::MOVE_FORWARD) {
+        usb_mouse_move(MOTION_STEP_X, MOTION_STEP_Y, 0, 0);
     } else {
-        digitalWriteFast(PIN_SEND_CLICK, HIGH);
+        usb_mouse_move(-MOTION_STEP_X, -MOTION_STEP_Y, 0, 0);
     }
 
-    // 2. Wait for the light sensor to detect the screen turning white.
-    while (fastAnalogRead(PIN_LIGHT_SENSOR) < LIGHT_SENSOR_THRESHOLD) {
-        if (latencyTimer > MEASUREMENT_TIMEOUT_MICROS) {
-            timeoutOccurred = true;
-            break;
-        }
-    }
-    
-    // 3. After detecting white (or timeout), release the click signal.
+    run.usbOffsetValid = usbPollPhaseKnown && usbWaitForPoll(timeoutCycles, edgeCycles);
+    run.usbOffsetCycles = run.usbOffsetValid ? edgeCycles - clickCycles : 0;
+    return clickCycles;
+}
+
+// Sends one untimed click that toggles the test screen, over USB or through the mouse switch.
+void sendToggleClick(bool isDirectMode) {
     if (isDirectMode) {
-        Mouse.release(MOUSE_LEFT);
+        Mouse.click(MOUSE_LEFT);
     } else {
+        digitalWriteFast(PIN_SEND_CLICK, HIGH);
+        delayMicroseconds(settings.clickHoldMicros);
         digitalWriteFast(PIN_SEND_CLICK, LOW);
     }
-    
-    if (timeoutOccurred) {
-        return AutoMeasureResult::TIMEOUT;
-    } else {
-        outLatencyMicros = latencyTimer;
-        return AutoMeasureResult::SUCCESS;
-    }
 }
 
-// Performs an intelligent synchronization routine for UE4 modes.
-SyncResult performSmartSync(bool isDirectMode) {
+// Performs an intelligent synchronization routine for UE4 modes (and Direct Motion, whose steps toggle
+// the screen the same way).
+template <typename Click>
+SyncResult performSmartSync() {
     // Announce the sync process
     drawSyncScreen("Sending focus click...");
 
     // --- Step 1: Send a "focus" click ---
     // This click ensures the target application window has OS focus.
-    if (isDirectMode) {
-        Mouse.click(MOUSE_LEFT);
-    } else {
-        digitalWriteFast(PIN_SEND_CLICK, HIGH);
-        delayMicroseconds(MOUSE_CLICK_HOLD_MICROS);
-        digitalWriteFast(PIN_SEND_CLICK, LOW);
-    }
+    Click::toggle();
     // Give the OS time to react to the focus change.
     if (delayWithJitterAndAbortCheck(250)) return SyncResult::HOLD_ABORT;
 
@@ -946,25 +1713,19 @@ SyncResult performSmartSync(bool isDirectMode) {
     drawSyncScreen("Checking state...");
     // Wait for light to stabilize after potential screen changes.
     if (delayWithJitterAndAbortCheck(500)) return SyncResult::HOLD_ABORT;
-    int initialState = fastAnalogRead(PIN_LIGHT_SENSOR);
+    int initialState = samplerLatest();
 
     // --- Step 3: Drive the state to DARK ---
     // We want to end this routine with the screen being black.
-    if (initialState >= LIGHT_SENSOR_THRESHOLD) {
+    if (initialState >= settings.lightThreshold) {
         // The screen is WHITE. Send one more click to toggle it to BLACK.
         drawSyncScreen("State is WHITE.", 24);
         alignText("Sending toggle click...", 40);
-        display.display();
+        rendererFlush();
         if (delayWithJitterAndAbortCheck(500)) return SyncResult::HOLD_ABORT;
 
-        if (isDirectMode) {
-            Mouse.click(MOUSE_LEFT);
-        } else {
-            digitalWriteFast(PIN_SEND_CLICK, HIGH);
-            delayMicroseconds(MOUSE_CLICK_HOLD_MICROS);
-            digitalWriteFast(PIN_SEND_CLICK, LOW);
-        }
-    } else if (initialState <= DARK_SENSOR_THRESHOLD) {
+        Click::toggle();
+    } else if (initialState <= settings.darkThreshold) {
         // The screen is already DARK. No extra click is needed.
         drawSyncScreen("State is already DARK.");
         if (delayWithJitterAndAbortCheck(1500)) return SyncResult::HOLD_ABORT;
@@ -973,7 +1734,7 @@ SyncResult performSmartSync(bool isDirectMode) {
         // The state is indeterminate (e.g., grey screen, mid-transition).
         drawSyncScreen("Indeterminate state!", 24);
         alignText("Sync failed. Retrying...", 40);
-        display.display();
+        rendererFlush();
         if (delayWithJitterAndAbortCheck(2000)) return SyncResult::HOLD_ABORT;
         return SyncResult::FAILED;
     }
@@ -982,7 +1743,7 @@ SyncResult performSmartSync(bool isDirectMode) {
     drawSyncScreen("Verifying DARK state...");
     elapsedMillis verificationTimer;
     while (verificationTimer < 3000) { // 3-second timeout for verification
-        if (fastAnalogRead(PIN_LIGHT_SENSOR) <= DARK_SENSOR_THRESHOLD) {
+        if (samplerLatest() <= settings.darkThreshold) {
             // Success! The screen is now dark and we are in a known state.
             drawSyncScreen("Sync complete.");
             if (delayWithJitterAndAbortCheck(1000)) return SyncResult::HOLD_ABORT;
@@ -995,12 +1756,400 @@ SyncResult performSmartSync(bool isDirectMode) {
     // If we get here, the verification timed out.
     drawSyncScreen("Sync FAILED!", 24);
     alignText("Screen not DARK. Retrying...", 40);
-    display.display();
+    rendererFlush();
     if (delayWithJitterAndAbortCheck(2000)) return SyncResult::HOLD_ABORT;
     return SyncResult::FAILED;
 }
 
+// --- Threshold Calibration ---
+// Derives the light/dark thresholds from the screen itself instead of hand-tuning config.h. The same
+// click toggling as the smart sync flips the test screen back and forth; after each click the level is
+// left to settle and then measured over a short window. Plateaus alternate between the two screen states,
+// so the even and odd plateaus each form one group, and the groups must not overlap. The dark threshold
+// sits CALIBRATION_DARK_PERCENT of the swing above the floor (and always above the noisiest dark sample),
+// the light threshold CALIBRATION_LIGHT_PERCENT above it. The result is saved to EEPROM like a host SET.
+
+// Averages the sample stream over CALIBRATION_WINDOW_MS. Returns false if samples were lost.
+bool measurePlateau(PlateauLevel& out) {
+    uint64_t sum = 0;
+    uint64_t sumSquares = 0;
+    uint32_t count = 0;
+    out.minValue = 255;
+    out.maxValue = 0;
+
+    samplerSync();
+    elapsedMillis windowTimer;
+    uint8_t value;
+    while (windowTimer < CALIBRATION_WINDOW_MS) {
+        while (samplerNext(value)) {
+            sum += value;
+            sumSquares += (uint32_t)value * value;
+            count++;
+            if (value < out.minValue) out.minValue = value;
+            if (value > out.maxValue) out.maxValue = value;
+        }
+    }
+    if (count == 0 || samplerOverrun) return false;
+
+    out.mean = (float)((double)sum / count);
+    double variance = (double)sumSquares / count - (double)out.mean * out.mean;
+    out.stdDev = variance > 0.0 ? (float)sqrt(variance) : 0.0f;
+    return true;
+}
+
+void performThresholdCalibration(bool isDirectMode) {
+    const int plateauCount = 2 * CALIBRATION_CYCLES + 1;
+    PlateauLevel plateaus[plateauCount];
+    calibrationOk = false;
+    calibrationDone = true;
+
+    drawSyncScreen("Sending focus click...");
+    sendToggleClick(isDirectMode);
+    if (delayWithJitterAndAbortCheck(CALIBRATION_SETTLE_MS)) { calibrationMessage = "Aborted."; return; }
+
+    // Plateau 0 is whatever the screen shows now, every further one follows a toggle click.
+    for (int i = 0; i < plateauCount; ++i) {
+        if (i > 0) {
+            sendToggleClick(isDirectMode);
+            if (delayWithJitterAndAbortCheck(CALIBRATION_SETTLE_MS)) { calibrationMessage = "Aborted."; return; }
+        }
+        drawSyncScreen(i % 2 == 0 ? "Measuring level A..." : "Measuring level B...");
+        if (!measurePlateau(plateaus[i])) { calibrationMessage = "Samples lost."; return; }
+    }
+
+    // Split the plateaus into the two alternating screen states.
+    float meanA = 0.0f, meanB = 0.0f;
+    float minA = 255.0f, maxA = 0.0f, minB = 255.0f, maxB = 0.0f;
+    float noise = 0.0f;
+    for (int i = 0; i < plateauCount; ++i) {
+        const PlateauLevel& level = plateaus[i];
+        if (i % 2 == 0) {
+            meanA += level.mean;
+            minA = min(minA, level.mean);
+            maxA = max(maxA, level.mean);
+        } else {
+            meanB += level.mean;
+            minB = min(minB, level.mean);
+            maxB = max(maxB, level.mean);
+        }
+        noise = max(noise, level.stdDev);
+    }
+    meanA /= CALIBRATION_CYCLES + 1;
+    meanB /= CALIBRATION_CYCLES;
+
+    // The toggle must have flipped the screen every time, otherwise the levels interleave.
+    if (!(maxA < minB || maxB < minA)) { calibrationMessage = "Screen not toggling."; return; }
+    bool darkIsA = meanA < meanB;
+    calibrationFloor = darkIsA ? meanA : meanB;
+    calibrationPeak = darkIsA ? meanB : meanA;
+    calibrationNoise = noise;
+
+    // Highest dark sample and lowest light sample seen on any plateau.
+    int darkCeiling = 0;
+    int lightFloor = 255;
+    for (int i = 0; i < plateauCount; ++i) {
+        bool isDark = (i % 2 == 0) == darkIsA;
+        if (isDark) darkCeiling = max(darkCeiling, (int)plateaus[i].maxValue);
+        else lightFloor = min(lightFloor, (int)plateaus[i].minValue);
+    }
+
+    float swing = calibrationPeak - calibrationFloor;
+    if (swing < CALIBRATION_MIN_SWING) { calibrationMessage = "Contrast too low."; return; }
+
+    int dark = (int)lroundf(calibrationFloor + swing * CALIBRATION_DARK_PERCENT / 100.0f);
+    int light = (int)lroundf(calibrationFloor + swing * CALIBRATION_LIGHT_PERCENT / 100.0f);
+    dark = max(dark, darkCeiling + 1);
+    light = max(light, dark + 1);
+    if (light > lightFloor - 1 || light > 255) { calibrationMessage = "Too noisy."; return; }
+
+    // Apply in an order that keeps light > dark valid at every step.
+    RuntimeConfig candidate = settings;
+    candidate.darkThreshold = min(candidate.darkThreshold, (int32_t)dark);
+    if (!configParamValid(candidate, CFG_LIGHT_THRESHOLD, light)) { calibrationMessage = "Invalid result."; return; }
+    candidate.lightThreshold = light;
+    if (!configParamValid(candidate, CFG_DARK_THRESHOLD, dark)) { calibrationMessage = "Invalid result."; return; }
+    candidate.darkThreshold = dark;
+
+    settings = candidate;
+    calibrationOk = true;
+    calibrationMessage = configSave() ? "Saved to EEPROM." : "EEPROM save failed.";
+}
+
+// --- Refresh Rate Detection ---
+// Finds the frame period from the small ripple the refresh leaves in the light (backlight strobing, scanout
+// of the sensor's own rows). The sample stream is averaged into REFRESH_DETECT_BIN_MICROS bins, the sample
+// clock being the time base, and the period is the strongest autocorrelation lag in the REFRESH_MIN_HZ to
+// REFRESH_MAX_HZ range, refined on its multiples to a fraction of a percent. The ripple folded onto one
+// period gives a fixed point of the frame to schedule the clicks against. The anchor drifts slowly with
+// the remaining period error, which shifts all phases alike and keeps their spread even.
+
+// Normalized autocorrelation of the recorded bins at 'lag' (1 = identical, 0 = unrelated).
+float refreshCorrelation(int32_t mean, uint32_t lag) {
+    int64_t product = 0;
+    int64_t energy = 0;
+    for (uint32_t i = 0; i + lag < REFRESH_DETECT_BINS; i++) {
+        int32_t a = (int32_t)refreshBins[i] - mean;
+        int32_t b = (int32_t)refreshBins[i + lag] - mean;
+        product += a * b;
+        energy += a * a;
+    }
+    return energy > 0 ? (float)((double)product / energy) : 0.0f;
+}
+
+// Sub-bin position of the correlation peak at 'lag' from a parabola through it and its neighbours.
+double refreshPeakInterpolate(int32_t mean, uint32_t lag) {
+    float below = refreshCorrelation(mean, lag - 1);
+    float center = refreshCorrelation(mean, lag);
+    float above = refreshCorrelation(mean, lag + 1);
+    float curvature = below - 2.0f * center + above;
+    return lag + (curvature < 0.0f ? 0.5 * (below - above) / curvature : 0.0);
+}
+
+// Returns false (and leaves the period at 0) if no clear ripple was found.
+bool detectRefreshRate() {
+    refreshPeriodCycles = 0.0;
+    refreshHz = 0.0f;
+    framePhaseNext = 0;
+    if (!ENABLE_FRAME_PHASE_SCHEDULING || samplerCyclesPerSample <= 0.0f) return false; // No bin buffer otherwise
+
+    const uint32_t samplesPerBin = max(1L, lroundf(REFRESH_DETECT_BIN_MICROS / samplerIntervalMicros));
+    const double binCycles = samplesPerBin * (double)samplerCyclesPerSample;
+    const double binMicros = binCycles / timebaseCyclesPerMicro;
+
+    // --- RECORD ---
+    uint32_t startIndex = samplerSync();
+    uint32_t startCycles = samplerIndexToCycles(startIndex);
+    uint32_t binSum = 0, binFill = 0, binCount = 0;
+    uint64_t total = 0;
+    elapsedMillis recordTimer;
+    uint8_t value;
+    while (binCount < REFRESH_DETECT_BINS) {
+        if (!samplerNext(value)) {
+            if (recordTimer > 2 * REFRESH_DETECT_WINDOW_MS) return false; // Sampler stalled
+            continue;
+        }
+        binSum += value;
+        if (++binFill == samplesPerBin) {
+            refreshBins[binCount] = (uint16_t)(binSum * 64 / samplesPerBin);
+            total += refreshBins[binCount];
+            binCount++;
+            binSum = 0;
+            binFill = 0;
+        }
+    }
+    if (samplerOverrun) return false;
+    const int32_t mean = (int32_t)(total / REFRESH_DETECT_BINS);
+
+    // --- COARSE PERIOD ---
+    const uint32_t minLag = max(2L, (long)ceil(1e6 / REFRESH_MAX_HZ / binMicros));
+    const uint32_t maxLag = min((long)(REFRESH_DETECT_BINS / 2), (long)floor(1e6 / REFRESH_MIN_HZ / binMicros));
+    if (maxLag <= minLag + 2) return false;
+
+    float best = -1.0f;
+    uint32_t bestLag = minLag;
+    for (uint32_t lag = minLag; lag <= maxLag; lag++) {
+        float correlation = refreshCorrelation(mean, lag);
+        if (correlation > best) { best = correlation; bestLag = lag; }
+    }
+    if (best < REFRESH_MIN_CORRELATION) return false;
+
+    // The peak can land on a multiple of the period, take the shortest divisor that correlates almost as well.
+    uint32_t periodLag = bestLag;
+    for (uint32_t divisor = bestLag / minLag; divisor >= 2; divisor--) {
+        uint32_t center = (bestLag + divisor / 2) / divisor;
+        uint32_t candidate = 0;
+        float candidateValue = -1.0f;
+        for (uint32_t lag = max(minLag, center - 1); lag <= min(maxLag, center + 1); lag++) {
+            float correlation = refreshCorrelation(mean, lag);
+            if (correlation > candidateValue) { candidateValue = correlation; candidate = lag; }
+        }
+        if (candidateValue >= 0.85f * best) { periodLag = candidate; break; }
+    }
+
+    // --- REFINE ---
+    // The peak is broad and noisy, so one lag is only good to a bin or so. Its multiples carry the same
+    // error divided by the multiple: step out by 4x at a time, each search window covering the error left
+    // by the previous step (but never reaching the neighbouring multiple).
+    double periodBins = refreshPeakInterpolate(mean, periodLag);
+    for (uint32_t multiple = 4; multiple * periodBins < REFRESH_DETECT_BINS / 2; multiple *= 4) {
+        uint32_t center = (uint32_t)lround(multiple * periodBins);
+        uint32_t window = max(2L, min((long)(periodBins / 3), (long)ceil(0.03 * multiple * periodBins)));
+        uint32_t peak = center;
+        float peakValue = -1.0f;
+        for (uint32_t lag = center - window; lag <= center + window; lag++) {
+            float correlation = refreshCorrelation(mean, lag);
+            if (correlation > peakValue) { peakValue = correlation; peak = lag; }
+        }
+        periodBins = refreshPeakInterpolate(mean, peak) / multiple;
+    }
+
+    // --- ANCHOR ---
+    // Fold the ripple onto one period; its darkest slot is the fixed point of the frame.
+    float slotSum[REFRESH_FOLD_SLOTS] = {0};
+    uint32_t slotCount[REFRESH_FOLD_SLOTS] = {0};
+    for (uint32_t i = 0; i < REFRESH_DETECT_BINS; i++) {
+        double position = (i + 0.5) / periodBins;
+        int slot = min((int)((position - floor(position)) * REFRESH_FOLD_SLOTS), REFRESH_FOLD_SLOTS - 1);
+        slotSum[slot] += refreshBins[i];
+        slotCount[slot]++;
+    }
+    int darkest = -1;
+    float darkestLevel = 0.0f;
+    for (int slot = 0; slot < REFRESH_FOLD_SLOTS; slot++) {
+        if (slotCount[slot] == 0) continue;
+        float level = slotSum[slot] / slotCount[slot];
+        if (darkest < 0 || level < darkestLevel) { darkest = slot; darkestLevel = level; }
+    }
+
+    refreshPeriodCycles = periodBins * binCycles;
+    refreshHz = (float)(timebaseCyclesPerMicro * 1e6 / refreshPeriodCycles);
+    refreshAnchorCycles = startCycles + (uint32_t)((darkest + 0.5) / REFRESH_FOLD_SLOTS * refreshPeriodCycles);
+    return true;
+}
+
+// Moves the anchor forward by whole frames so it stays behind the present by less than one frame.
+// Called between runs; the 32-bit counter difference is only valid for ~7 s.
+void refreshAdvanceAnchor() {
+    if (refreshPeriodCycles <= 0.0) return;
+    uint32_t sinceAnchor = timestampNow() - refreshAnchorCycles;
+    double frames = floor(sinceAnchor / refreshPeriodCycles);
+    refreshAnchorCycles += (uint32_t)llround(frames * refreshPeriodCycles);
+}
+
+// Waits for the next phase of a stratified sequence: every round visits each of the FRAME_PHASE_STRATA
+// slots once in random order, at a random point within the slot. Returns the phase (0 to 1) of the
+// moment it returns, or -1 without a detected refresh rate.
+float framePhaseWait() {
+    if (!ENABLE_FRAME_PHASE_SCHEDULING || refreshPeriodCycles <= 0.0) return -1.0f;
+
+    if (framePhaseNext == 0) {
+        for (int i = 0; i < FRAME_PHASE_STRATA; i++) framePhaseOrder[i] = i;
+        for (int i = FRAME_PHASE_STRATA - 1; i > 0; i--) std::swap(framePhaseOrder[i], framePhaseOrder[random(i + 1)]);
+    }
+    float phase = (framePhaseOrder[framePhaseNext] + random(1000) / 1000.0f) / FRAME_PHASE_STRATA;
+    framePhaseNext = (framePhaseNext + 1) % FRAME_PHASE_STRATA;
+
+    refreshAdvanceAnchor();
+    uint32_t now = timestampNow();
+    uint32_t sinceAnchor = now - refreshAnchorCycles;
+    uint32_t target = (uint32_t)(phase * refreshPeriodCycles);
+    uint32_t wait = target >= sinceAnchor ? target - sinceAnchor
+                                          : (uint32_t)(target + refreshPeriodCycles) - sinceAnchor;
+    while (timestampNow() - now < wait);
+    return phase;
+}
+
+// --- Instrument Benchmark ---
+// Measures what the tester itself adds. The loopback needs an LED (with resistor) from PIN_SEND_CLICK to
+// ground, placed over the light sensor: it then runs the exact press/detect path of the Auto modes, so
+// its mean is the bias of the instrument. The primitives are timed back to back with the cycle counter,
+// minus the cost of the timestamp pair itself. Results go to the screen and, as FRAME_TYPE_BENCHMARK
+// frames, to the serial telemetry.
+
+void benchmarkAdd(BenchmarkResult& result, float micros) {
+    result.count++;
+    if (result.count == 1 || micros < result.minMicros) result.minMicros = micros;
+    if (micros > result.maxMicros) result.maxMicros = micros;
+    float delta = micros - result.meanMicros;
+    result.meanMicros += delta / result.count;
+    result.sumSquaredDiff += (double)delta * (micros - result.meanMicros);
+    p2Add(result.p50, micros);
+    p2Add(result.p99, micros);
+}
+
+// Times 'iterations' calls of operation(i). The timestamp reads are inline, so only they are subtracted.
+template <typename Operation>
+void benchmarkPrimitive(BenchmarkResult& result, int iterations, uint32_t overheadCycles, Operation operation) {
+    for (int i = 0; i < iterations; ++i) {
+        uint32_t start = timestampNow();
+        operation(i);
+        uint32_t elapsed = timestampNow() - start;
+        benchmarkAdd(result, cyclesToMicros(elapsed > overheadCycles ? elapsed - overheadCycles : 0));
+    }
+}
+
+// Returns false if aborted with a hold. A first click that never sees light means there is no LED,
+// the loopback is left empty.
+bool benchmarkLoopback() {
+    BenchmarkResult& result = benchmarkResults[BENCH_LOOPBACK];
+    for (int i = 0; i < BENCHMARK_LOOPBACK_RUNS; ++i) {
+        elapsedMicros darkTimer;
+        while (samplerLatest() > settings.darkThreshold) {
+            if (darkTimer > settings.measurementTimeoutMicros) return true; // LED stuck on or ambient light
+        }
+        if (delayWithJitterAndAbortCheck(BENCHMARK_LOOPBACK_DELAY_MS)) return false;
+
+        RunResult run;
+        uint32_t clickIndex = edgeDetectArm(true);
+        uint32_t clickCycles = PinClick::press(run);
+        bool detected = edgeDetectWait<true>(clickIndex, clickCycles, run);
+        PinClick::release();
+        if (!detected) return true;
+        benchmarkAdd(result, cyclesToMicros(run.latencyCycles));
+    }
+    return true;
+}
+
+void performBenchmark() {
+    for (int i = 0; i < BENCH_COUNT; ++i) benchmarkResults[i] = BenchmarkResult();
+    benchmarkDone = true;
+
+    drawSyncScreen("Loopback...");
+    if (!benchmarkLoopback()) return;
+
+    drawSyncScreen("Timing primitives...");
+    // The cheapest observed pair is the fixed cost of the measurement itself.
+    uint32_t overheadCycles = UINT32_MAX;
+    for (int i = 0; i < BENCHMARK_ITERATIONS; ++i) {
+        uint32_t start = timestampNow();
+        uint32_t elapsed = timestampNow() - start;
+        overheadCycles = min(overheadCycles, elapsed);
+        benchmarkAdd(benchmarkResults[BENCH_TIMESTAMP], cyclesToMicros(elapsed));
+    }
+
+    benchmarkPrimitive(benchmarkResults[BENCH_ANALOG_READ], BENCHMARK_ITERATIONS, overheadCycles,
+                       [](int) { benchmarkSink = fastAnalogRead(PIN_LIGHT_SENSOR); });
+    // Writing the level the pin already has costs the same as a click edge without sending one.
+    benchmarkPrimitive(benchmarkResults[BENCH_PIN_WRITE], BENCHMARK_ITERATIONS, overheadCycles,
+                       [](int) { digitalWriteFast(PIN_SEND_CLICK, LOW); });
+    // A zero move goes through the same report queue as a click but leaves the PC alone.
+    if (usb_configuration != 0) {
+        benchmarkPrimitive(benchmarkResults[BENCH_USB_REPORT], BENCHMARK_ITERATIONS, overheadCycles,
+                           [](int) { usb_mouse_move(0, 0, 0, 0); });
+    }
+    // Resending pages the panel already shows keeps the renderer shadow valid.
+    benchmarkPrimitive(benchmarkResults[BENCH_DISPLAY_PAGE], BENCHMARK_DISPLAY_ITERATIONS, overheadCycles,
+                       [](int i) { rendererSendPage(i % DISPLAY_PAGE_COUNT); });
+
+    if (ENABLE_SERIAL_TELEMETRY) benchmarkSendReports();
+}
+
+void benchmarkSendReports() {
+    for (int i = 0; i < BENCH_COUNT; ++i) {
+        const BenchmarkResult& result = benchmarkResults[i];
+        BenchmarkReport report;
+        report.id = i;
+        memset(report.reserved, 0, sizeof(report.reserved));
+        report.count = result.count;
+        report.minMicros = result.minMicros;
+        report.meanMicros = result.meanMicros;
+        report.p50Micros = p2Value(result.p50);
+        report.p99Micros = p2Value(result.p99);
+        report.maxMicros = result.maxMicros;
+        report.stdDevMicros = result.count > 1 ? (float)sqrt(result.sumSquaredDiff / (result.count - 1)) : 0.0f;
+        telemetrySendFrame(FRAME_TYPE_BENCHMARK, &report, sizeof(report));
+    }
+}
+
 // --- SD Card Functions ---
+// Runs are streamed to a binary log while the session is running instead of being buffered in
+// RAM and dumped at the end. Each run appends one fixed-size LogRecord to one of two 512-byte
+// buffers; a full buffer is written as a single sector-aligned chunk during the next inter-run
+// delay while the other one keeps filling. The file is pre-allocated up front so the card writes
+// into contiguous clusters. RAM use is constant no matter how long a session runs.
+// File layout: one 512-byte sector holding LogHeader, followed by packed LogRecords.
+// scripts/ldat_log_to_csv.py converts logs on the host; SD_LOG_EXPORT_CSV also writes a
+// CSV copy on the device when a session ends.
 
 // Helper to get a string representation of the current mode for filenames
 String getModeString(State mode) {
@@ -1008,233 +2157,2332 @@ String getModeString(State mode) {
     if (mode == State::DIRECT_AUTO_MODE) return "DIRECT_AUTO";
     if (mode == State::AUTO_UE4_APERTURE) return "AUTO_UE4";
     if (mode == State::DIRECT_UE4_APERTURE) return "DIRECT_UE4";
+    if (mode == State::DIRECT_MOTION) return "DIRECT_MOTION";
     return "UNKNOWN";
 }
 
-// Finds the next available file number for a given base name to prevent overwriting files.
-int getNextFileNumber(const String& path, const String& baseName) {
-    int fileNumber = 1;
-    while (true) {
-        // Using String objects for path manipulation is safer
-        String fileName = path + "/" + baseName + "_" + String(fileNumber) + ".csv";
-        if (!SD.exists(fileName.c_str())) { // FIX: Use .c_str() for SD library functions
-            return fileNumber;
-        }
-        fileNumber++;
-        if (fileNumber > 9999) return -1; // Safety break
+// Stable numeric mode codes for log records (State values may be reordered, these must not).
+uint8_t getLogModeCode(State mode) {
+    if (mode == State::AUTO_MODE) return 1;
+    if (mode == State::DIRECT_AUTO_MODE) return 2;
+    if (mode == State::AUTO_UE4_APERTURE) return 3;
+    if (mode == State::DIRECT_UE4_APERTURE) return 4;
+    if (mode == State::DIRECT_MOTION) return 5;
+    return 0;
+}
+
+// Takes the next session number from the card's index file and stores its successor.
+// Returns 0 if the index can't be written. A missing or damaged index restarts at 1, the
+// caller skips numbers whose log already exists.
+uint32_t sessionIndexNext() {
+    String indexPath = String(SD_LOG_DIRECTORY) + "/" + SD_INDEX_FILE;
+    FsFile indexFile = SD.sdfs.open(indexPath.c_str(), O_RDWR | O_CREAT);
+    if (!indexFile) return 0;
+
+    SessionIndex index;
+    if (indexFile.read(&index, sizeof(index)) != (int)sizeof(index) || index.magic != SESSION_INDEX_MAGIC ||
+        index.nextSession == 0) {
+        index.magic = SESSION_INDEX_MAGIC;
+        index.nextSession = 1;
     }
+    uint32_t session = index.nextSession;
+
+    // Stored before the log is created, so a power loss can skip a number but never reuse one.
+    index.nextSession++;
+    indexFile.seekSet(0);
+    bool written = indexFile.write(&index, sizeof(index)) == sizeof(index);
+    indexFile.close();
+    return written ? session : 0;
 }
 
-// Writes the collected latency data to a specified file.
-void writeLogFile(const String& filePath, const std::vector<float>& latencies1, const std::vector<float>& latencies2 = {}) {
-    File dataFile = SD.open(filePath.c_str(), FILE_WRITE); // FIX: Use .c_str() for SD library functions
-    if (dataFile) {
-        if (latencies2.empty()) { // Single column log for AUTO mode
-            dataFile.println("Latency (ms)");
-            for (const auto& latency : latencies1) {
-                dataFile.println(latency, 4); // Print with 4 decimal places
-            }
-        } else { // Dual column log for UE4 modes
-            dataFile.println("B-to-W (ms),W-to-B (ms)");
-            size_t maxRows = max(latencies1.size(), latencies2.size());
-            for (size_t i = 0; i < maxRows; ++i) {
-                if (i < latencies1.size()) {
-                    dataFile.print(latencies1[i], 4);
-                }
-                dataFile.print(",");
-                if (i < latencies2.size()) {
-                    dataFile.print(latencies2[i], 4);
-                }
-                dataFile.println();
-            }
-        }
-        dataFile.close();
+// Appends the session's line to the manifest, with a header line when the manifest is new.
+void sessionManifestAppend(uint32_t session, const String& fileName, State mode, unsigned long run_limit) {
+    String manifestPath = String(SD_LOG_DIRECTORY) + "/" + SD_MANIFEST_FILE;
+    FsFile manifest = SD.sdfs.open(manifestPath.c_str(), O_RDWR | O_CREAT | O_APPEND);
+    if (!manifest) return;
+
+    char line[192];
+    if (manifest.fileSize() == 0) {
+        manifest.print("Session,File,Mode,Run Limit,Precision Target (us),Light Threshold,Dark Threshold,"
+                       "Click Hold (us),USB Poll (Hz),Refresh (Hz),Firmware\n");
+    }
+    char precisionStr[16] = "";
+    char refreshStr[16] = "";
+    if (precisionRunLimit) dtostrf(PRECISION_TARGET_MICROS, 1, 1, precisionStr);
+    if (refreshHz > 0) dtostrf(refreshHz, 1, 3, refreshStr);
+    snprintf(line, sizeof(line), "%lu,%s,%s,%lu,%s,%d,%d,%lu,%d,%s,%s\n", (unsigned long)session, fileName.c_str(),
+             getModeString(mode).c_str(), run_limit, precisionStr, (int)settings.lightThreshold,
+             (int)settings.darkThreshold, (unsigned long)settings.clickHoldMicros, USB_POLL_RATE_HZ, refreshStr,
+             FIRMWARE_BUILD);
+    manifest.print(line);
+    manifest.close();
+}
+
+// Shows the "SAVING LOG..." screen with a truncated version of the path if it's too long.
+void drawSavingScreen(const String& filePath) {
+    display.clearDisplay();
+    display.setTextSize(1);
+    display.setTextColor(SSD1306_WHITE);
+    alignText("SAVING LOG...", 16);
+    String displayPath = filePath;
+    if (displayPath.length() > 21) {
+        displayPath = "..." + displayPath.substring(displayPath.length() - 18);
     }
+    alignText(displayPath.c_str(), 32);
+    rendererFlush();
 }
 
-// Main function to handle the logic of saving data to the SD card.
-void saveDataToSD(State mode, unsigned long run_limit, bool is_partial_save) {
+// Creates the binary log for a new session. Logging stays off for the session if this fails.
+void sdLoggerOpen(State mode, unsigned long run_limit) {
     if (!sdCardPresent || !ENABLE_SD_LOGGING) return;
+    sdLoggerFinish(); // Never leave a previous session dangling
 
     String modeStr = getModeString(mode);
     String baseFileName;
-    if (run_limit > 0) {
+    if (precisionRunLimit) {
+        baseFileName = modeStr + "_PRECISE";
+    } else if (run_limit > 0) {
         baseFileName = modeStr + "_" + String(run_limit) + "runs";
     } else {
-        baseFileName = modeStr + "_UNLIMITED_part";
+        baseFileName = modeStr + "_UNLIMITED";
     }
 
-    int fileNum = getNextFileNumber(SD_LOG_DIRECTORY, baseFileName);
-    if (fileNum == -1) {
-        displayErrorScreen("SD CARD ERROR", "Could not find", "a free file name.", "Aborting save...");
+    // Numbers are unique per card. Only a reset index (or logs copied in) can hit an existing name.
+    uint32_t session = sessionIndexNext();
+    String fileName;
+    for (int attempt = 0; session != 0; attempt++) {
+        fileName = baseFileName + "_" + String(session) + ".bin";
+        if (!SD.exists((String(SD_LOG_DIRECTORY) + "/" + fileName).c_str())) break;
+        session = attempt < 9999 ? sessionIndexNext() : 0;
+    }
+    if (session == 0) {
+        displayErrorScreen("SD CARD ERROR", "Could not find", "a free file name.", "Logging disabled...");
         return;
     }
-    String filePath = String(SD_LOG_DIRECTORY) + "/" + baseFileName + "_" + String(fileNum) + ".csv";
+    logFilePath = String(SD_LOG_DIRECTORY) + "/" + fileName;
 
-    // Show "Saving..." message on screen
-    display.clearDisplay();
-    display.setTextSize(1);
-    display.setTextColor(SSD1306_WHITE);
-    alignText("SAVING LOG...", 16);
-    // Display a truncated version of the path if it's too long
-    String displayPath = filePath;
-    if (displayPath.length() > 21) {
-        displayPath = "..." + displayPath.substring(displayPath.length() - 18);
+    logFile = SD.sdfs.open(logFilePath.c_str(), O_RDWR | O_CREAT | O_TRUNC);
+    if (!logFile) {
+        displayErrorScreen("SD CARD ERROR", "Could not create", "the log file.", "Logging disabled...");
+        return;
     }
-    alignText(displayPath.c_str(), 32);
-    display.display();
+    // Reserve contiguous space up front, the file is truncated to its real size on close.
+    // Unlimited sessions that outgrow it simply continue with normal cluster allocation.
+    logFile.preAllocate(LOG_SECTOR_SIZE + (uint64_t)SD_LOG_PREALLOCATE_RUNS * sizeof(LogRecord));
+
+    memset(&logHeader, 0, sizeof(logHeader));
+    memcpy(logHeader.magic, LOG_MAGIC, sizeof(logHeader.magic));
+    logHeader.version = LOG_FORMAT_VERSION;
+    logHeader.recordSize = sizeof(LogRecord);
+    logHeader.cpuHz = F_CPU_ACTUAL;
+    logHeader.runLimit = run_limit;
+    logHeader.mode = getLogModeCode(mode);
+    logHeader.lightThreshold = settings.lightThreshold;
+    logHeader.darkThreshold = settings.darkThreshold;
+    logHeader.sampleIntervalMicros = samplerIntervalMicros;
+    logHeader.refreshHz = refreshHz;
+    logHeader.usbPollRateHz = USB_POLL_RATE_HZ;
+    logHeader.clickHoldMicros = settings.clickHoldMicros;
+    logWriteHeader();
+    sessionManifestAppend(session, fileName, mode, run_limit);
+    if (mode == State::AUTO_UE4_APERTURE || mode == State::DIRECT_UE4_APERTURE || mode == State::DIRECT_MOTION) {
+        waveformOpenFile(logFilePath);
+    }
+
+    logActiveBuffer = 0;
+    logBufferFill = 0;
+    logBufferPending[0] = logBufferPending[1] = false;
+    logOldestPending = 0;
+    logRecordCount = 0;
+    logDroppedRecords = 0;
+}
+
+// Writes the header into the first sector. The file position is left right after it.
+void logWriteHeader() {
+    uint8_t sector[LOG_SECTOR_SIZE] = {0};
+    memcpy(sector, &logHeader, sizeof(logHeader));
+    logFile.seekSet(0);
+    logFile.write(sector, LOG_SECTOR_SIZE);
+}
 
-    // Write the actual file
-    if (mode == State::AUTO_MODE) {
-        writeLogFile(filePath, latenciesAuto);
-        if (is_partial_save) latenciesAuto.clear();
-    } else if (mode == State::DIRECT_AUTO_MODE) {
-        writeLogFile(filePath, latenciesDirectAuto);
-        if (is_partial_save) latenciesDirectAuto.clear();
-    } else if (mode == State::AUTO_UE4_APERTURE) {
-        writeLogFile(filePath, latenciesBtoW, latenciesWtoB);
-        if (is_partial_save) { latenciesBtoW.clear(); latenciesWtoB.clear(); }
-    } else if (mode == State::DIRECT_UE4_APERTURE) {
-        writeLogFile(filePath, latenciesDirectBtoW, latenciesDirectWtoB);
-        if (is_partial_save) { latenciesDirectBtoW.clear(); latenciesDirectWtoB.clear(); }
+// Appends one run to the active RAM buffer. Called on the measurement path, so it only copies bytes.
+void sdLoggerAppend(const LogRecord& record) {
+    if (!logFile) return;
+    if (logBufferPending[logActiveBuffer]) {
+        // Both buffers are waiting for the card, the writer did not get an idle slot in time.
+        logDroppedRecords++;
+        return;
+    }
+    memcpy(logBuffers[logActiveBuffer] + logBufferFill, &record, sizeof(record));
+    logBufferFill += sizeof(record);
+    logRecordCount++;
+
+    if (logBufferFill == LOG_SECTOR_SIZE) {
+        logBufferPending[logActiveBuffer] = true;
+        logActiveBuffer ^= 1;
+        logBufferFill = 0;
+    }
+}
+
+// Writes at most one full buffer to the card. Called from inter-run delays only.
+// Returns true if a write was made.
+bool sdLoggerPump() {
+    if (!logFile) return false;
+    // Not simply the inactive buffer: once both are full the active one wraps back onto the older of them.
+    int buffer = logOldestPending;
+    if (!logBufferPending[buffer]) return false;
+
+    logFile.write(logBuffers[buffer], LOG_SECTOR_SIZE);
+    logBufferPending[buffer] = false;
+    logOldestPending ^= 1; // The other buffer filled after this one, if it is pending it goes next
+
+    // Periodically commit the directory entry so a power loss costs at most a few sectors.
+    logSectorsSinceSync++;
+    if (logSectorsSinceSync >= SD_LOG_SYNC_INTERVAL_SECTORS) {
+        logFile.sync();
+        logSectorsSinceSync = 0;
+    }
+    return true;
+}
+
+// Flushes everything still in RAM, finalizes the header and closes the log. Safe to call
+// when no log is open. Runs outside measurement, so it is allowed to block.
+void sdLoggerFinish() {
+    if (waveformFile) {
+        while (waveformPumpSd());
+        waveformFile.close();
     }
+    if (!logFile) return;
 
-    delay(1000); // Let user see the save message before continuing
+    while (sdLoggerPump()); // Both full buffers in order, then the partial one
+    if (logBufferFill > 0) logFile.write(logBuffers[logActiveBuffer], logBufferFill);
+    logFile.truncate(); // Drop the unused pre-allocated tail
+
+    logHeader.recordCount = logRecordCount;
+    logHeader.droppedRecords = logDroppedRecords;
+    logHeader.syncTimeouts = phaseStats.syncTimeouts;
+    logHeader.edgeTimeouts = phaseStats.edgeTimeouts;
+    logHeader.aborts = phaseStats.aborts;
+    logWriteHeader();
+    logFile.close();
+
+    if (SD_LOG_EXPORT_CSV) sdLoggerExportCsv(logFilePath);
+}
+
+// Converts a finished binary log into a CSV file next to it (same name, .csv extension).
+void sdLoggerExportCsv(const String& binPath) {
+    String csvPath = binPath.substring(0, binPath.length() - 4) + ".csv";
+    drawSavingScreen(csvPath);
+
+    FsFile binFile = SD.sdfs.open(binPath.c_str(), O_RDONLY);
+    FsFile csvFile = SD.sdfs.open(csvPath.c_str(), O_RDWR | O_CREAT | O_TRUNC);
+    if (!binFile || !csvFile) {
+        binFile.close();
+        csvFile.close();
+        displayErrorScreen("SD CARD ERROR", "Could not export", "the CSV log.", "Continuing...");
+        return;
+    }
+
+    LogHeader header;
+    binFile.read(&header, sizeof(header));
+    binFile.seekSet(LOG_SECTOR_SIZE);
+    float cyclesPerMilli = header.cpuHz / 1000.0f;
+
+    // Lines are batched in a sector-sized buffer, one println() per value would be far slower.
+    char text[LOG_SECTOR_SIZE];
+    size_t textFill = snprintf(text, sizeof(text), "Run,Direction,Latency (ms),Latency (cycles),Timestamp (ms),USB Offset (us),Sensor,Sync Wait (ms),Samples,Frame Phase\n");
+    LogRecord record;
+    while (binFile.read(&record, sizeof(record)) == (int)sizeof(record)) {
+        char line[112];
+        char latencyStr[16];
+        char usbOffsetStr[16] = "";
+        char syncWaitStr[16];
+        char framePhaseStr[16] = "";
+        char sensorStr[8] = "Audio";
+        if (record.sensor != LOG_SENSOR_AUDIO) snprintf(sensorStr, sizeof(sensorStr), "%u", record.sensor + 1);
+        dtostrf(record.latencyCycles / cyclesPerMilli, 1, 6, latencyStr);
+        dtostrf(record.syncWaitCycles / cyclesPerMilli, 1, 3, syncWaitStr);
+        if (record.flags & LOG_FLAG_FRAME_PHASED) dtostrf(record.framePhase / 256.0f, 1, 3, framePhaseStr);
+        if (record.flags & LOG_FLAG_USB_OFFSET) {
+            dtostrf(record.usbOffsetCycles / (cyclesPerMilli / 1000.0f), 1, 3, usbOffsetStr);
+        }
+        int len = snprintf(line, sizeof(line), "%lu,%s,%s,%lu,%lu,%s,%s,%s,%lu,%s\n", (unsigned long)record.runIndex,
+                           record.direction == (uint8_t)Transition::DARK_TO_LIGHT ? "B-to-W" : "W-to-B",
+                           latencyStr, (unsigned long)record.latencyCycles, (unsigned long)record.timestampMs,
+                           usbOffsetStr, sensorStr, syncWaitStr, (unsigned long)record.sampleCount, framePhaseStr);
+        if (textFill + len > sizeof(text)) {
+            csvFile.write(text, textFill);
+            textFill = 0;
+        }
+        memcpy(text + textFill, line, len);
+        textFill += len;
+    }
+    csvFile.write(text, textFill);
+    csvFile.close();
+    binFile.close();
 }
 
 // --- Optimized Analog Read ---
 // Wrapper for the ADC library to perform a faster analog read using our pre-configured settings.
-// Marked 'FASTRUN' to be placed in ITCM for maximum speed, as it's called repeatedly inside measurement loops.
+// Always uses ADC2, ADC1 is permanently streaming the light sensor (see the sampling engine below).
 FASTRUN int fastAnalogRead(uint8_t pin) {
-    return adc->analogRead(pin);
+    if (!ENABLE_INTERLEAVED_SAMPLING) return adc->adc1->analogRead(pin);
+
+    // ADC2 is streaming the light sensor, borrow it and restart its half of the stream afterwards.
+    // Only used outside of measurements (mouse checks), so the short gap in the stream doesn't matter.
+    adc->adc1->stopContinuous();
+    adc->adc1->disableDMA();
+    int value = adc->adc1->analogRead(pin);
+    samplerStartSecondary();
+    return value;
 }
 
-// --- Helper function to centralize statistics calculations ---
-void updateStats(LatencyStats& stats, std::vector<float>& latencies, unsigned long latencyMicros) {
-    float latencyMillis = latencyMicros / 1000.0f;
+// --- High-Resolution Timebase ---
+// Every latency is measured with the ARM DWT cycle counter. At 600 MHz one tick is ~1.67ns and
+// reading it is a single load, unlike micros() which has 1us resolution and its own overhead.
+// The 32-bit counter wraps every ~7s, far longer than the 5 s maximum measurement timeout, so plain
+// unsigned subtraction of two timestamps is always correct.
+
+// Makes sure the cycle counter is running (the core already enables it, this is just a safeguard).
+void timebaseBegin() {
+    ARM_DEMCR |= ARM_DEMCR_TRCENA;
+    ARM_DWT_CTRL |= ARM_DWT_CTRL_CYCCNTENA;
+    timebaseCyclesPerMicro = F_CPU_ACTUAL / 1000000.0f;
+}
+
+FASTRUN uint32_t timestampNow() {
+    return ARM_DWT_CYCCNT;
+}
+
+float cyclesToMicros(uint32_t cycles) {
+    return cycles / timebaseCyclesPerMicro;
+}
+
+uint32_t microsToCycles(unsigned long micros) {
+    return (uint32_t)(micros * timebaseCyclesPerMicro);
+}
+
+// --- Light Sensor Sampling Engine ---
+// ADC1 converts PIN_LIGHT_SENSOR back-to-back in continuous mode and a DMA channel copies every
+// 8-bit result into 'sampleRing'. Because conversions happen at a fixed rate, a sample's absolute
+// index IS its timestamp: each sync pairs the current index with the cycle counter, and any later
+// sample is placed at anchor + (index - anchorIndex) * samplerCyclesPerSample. Measurement code
+// timestamps the click and consumes the ring until the threshold is crossed, so the reported
+// latency no longer depends on how long each loop iteration takes.
+// With ENABLE_INTERLEAVED_SAMPLING, ADC2 converts the same pin half a period after ADC1 into a second
+// ring. Merged index 2k is ADC1's k-th sample, 2k+1 ADC2's, so everything downstream simply sees one
+// stream at twice the rate. The real ADC2 offset is measured once and corrected in samplerIndexToCycles.
+
+// Starts the continuous conversion + DMA stream and measures the real sample interval.
+// Returns false if no samples arrive (ADC or DMA failed to start).
+bool samplerBegin() {
+    sampleDma.begin(true);
+    sampleDma.source((volatile uint8_t &)ADC1_R0); // 8-bit results sit in the low byte of R0
+    sampleDma.destinationCircular(sampleRing, SAMPLE_RING_SIZE);
+    sampleDma.transferCount(SAMPLE_RING_SIZE);
+    sampleDma.triggerAtHardwareEvent(DMAMUX_SOURCE_ADC1);
+    sampleDma.enable();
+
+    adc->adc0->enableDMA();
+    if (!adc->adc0->startContinuous(PIN_LIGHT_SENSOR)) return false;
+
+    // Measure how many conversions complete in a known number of CPU cycles. Both ends are taken
+    // right as a conversion lands, so they are off by the polling delay rather than up to a sample.
+    const uint32_t windowCycles = microsToCycles(SAMPLE_RATE_CALIBRATION_MICROS);
+    const uint32_t conversionTimeoutCycles = microsToCycles(1000);
+    uint32_t startIndex, startCycles, endIndex, endCycles;
+    if (!samplerWaitForConversion(conversionTimeoutCycles, startIndex, startCycles)) return false;
+    while (timestampNow() - startCycles < windowCycles) {
+        samplerRefresh(); // Poll often enough to never miss a ring wrap
+    }
+    if (!samplerWaitForConversion(conversionTimeoutCycles, endIndex, endCycles)) return false;
+    uint32_t sampleCount = endIndex - startIndex;
+    uint32_t elapsedCycles = endCycles - startCycles;
+
+    samplerCyclesPerSample = (float)((double)elapsedCycles / sampleCount);
+    samplerIntervalMicros = (float)((double)cyclesToMicros(elapsedCycles) / sampleCount);
+    samplerPrimaryCyclesPerSample = samplerCyclesPerSample;
+    samplerRateRefIndex = startIndex;
+    samplerRateRefCycles = startCycles;
+    samplerRateRefMillis = millis() - SAMPLE_RATE_CALIBRATION_MICROS / 1000;
+
+    if (ENABLE_INTERLEAVED_SAMPLING) {
+        sampleDmaSecondary.begin(true);
+        sampleDmaSecondary.source((volatile uint8_t &)ADC2_R0);
+        sampleDmaSecondary.destinationCircular(sampleRingSecondary, SAMPLE_RING_SIZE);
+        sampleDmaSecondary.transferCount(SAMPLE_RING_SIZE);
+        sampleDmaSecondary.triggerAtHardwareEvent(DMAMUX_SOURCE_ADC2);
+        sampleDmaSecondary.enable();
+        samplerStartSecondary();
+        if (!samplerInterleaved) return false;
+
+        // Measure where ADC2's conversions really land between ADC1's by timestamping both heads
+        // as they advance. Polling delay hits both streams alike and averages out.
+        const float periodCycles = samplerCyclesPerSample;
+        uint32_t lastPrimary = samplerPrimaryHead;
+        uint32_t lastSecondary = samplerSecondaryHead;
+        uint32_t primaryCycles = 0;
+        bool primarySeen = false;
+        double phaseSum = 0.0;
+        uint32_t phaseCount = 0;
+        const uint32_t phaseWindowCycles = microsToCycles(SAMPLE_PHASE_CALIBRATION_MICROS);
+        startCycles = timestampNow();
+        while (timestampNow() - startCycles < phaseWindowCycles) {
+            samplerRefresh();
+            uint32_t now = timestampNow();
+            if (samplerPrimaryHead != lastPrimary) {
+                lastPrimary = samplerPrimaryHead;
+                primaryCycles = now;
+                primarySeen = true;
+            }
+            if (samplerSecondaryHead != lastSecondary) {
+                lastSecondary = samplerSecondaryHead;
+                float phase = (float)(now - primaryCycles);
+                if (primarySeen && phase < periodCycles) {
+                    phaseSum += phase;
+                    phaseCount++;
+                }
+            }
+        }
+        if (phaseCount == 0) return false;
+
+        // From here on a "sample" is one step of the merged stream.
+        samplerPhaseSkew = (float)(phaseSum / phaseCount) - periodCycles / 2.0f;
+        samplerCyclesPerSample /= 2.0f;
+        samplerIntervalMicros /= 2.0f;
+    }
+    samplerSync();
+    return true;
+}
+
+// (Re)starts ADC2's continuous conversion half an ADC1 period after an ADC1 conversion completes.
+// Each start opens a new pairing segment: ADC2's first sample is paired with the ADC1 sample right
+// before it, and the merged index continues from an even value above anything handed out so far.
+void samplerStartSecondary() {
+    const uint32_t periodCycles = (uint32_t)samplerPrimaryCyclesPerSample;
+    adc->adc1->stopContinuous();
+
+    noInterrupts();
+    // Line up with an ADC1 completion.
+    uint32_t primary = samplerPrimaryHead;
+    uint32_t waitStart = timestampNow();
+    while (samplerPrimaryHead == primary && timestampNow() - waitStart < 4 * periodCycles) samplerRefresh();
+    uint32_t edgeCycles = timestampNow();
+    uint32_t secondary = samplerSecondaryHead;
+    while (timestampNow() - edgeCycles < periodCycles / 2);
+    adc->adc1->enableDMA();
+    adc->adc1->startContinuous(PIN_LIGHT_SENSOR);
+
+    // Pair on ADC2's first result instead of assuming how long its first conversion takes.
+    waitStart = timestampNow();
+    while (samplerSecondaryHead == secondary && timestampNow() - waitStart < 4 * periodCycles) samplerRefresh();
+    if (samplerSecondaryHead != secondary) {
+        samplerMergeBase = (samplerHead + 1) & ~1u; // Keep ADC1 on even indices
+        samplerPrimaryOffset = samplerPrimaryHead - 1;
+        samplerSecondaryOffset = secondary;
+        samplerInterleaved = true;
+        samplerRefresh();
+    }
+    interrupts();
+}
+
+// Advances 'samplerHead' by however far the DMA has written since the last call.
+// Must be called at least once per ring period while a measurement depends on absolute indices.
+FASTRUN uint32_t samplerRefresh() {
+    uint32_t pos = ((uintptr_t)sampleDma.TCD->DADDR - (uintptr_t)sampleRing) & (SAMPLE_RING_SIZE - 1);
+    samplerPrimaryHead += (pos - samplerLastPos) & (SAMPLE_RING_SIZE - 1);
+    samplerLastPos = pos;
+    if (!ENABLE_INTERLEAVED_SAMPLING || !samplerInterleaved) return samplerHead = samplerPrimaryHead;
+
+    uint32_t secondaryPos = ((uintptr_t)sampleDmaSecondary.TCD->DADDR - (uintptr_t)sampleRingSecondary) & (SAMPLE_RING_SIZE - 1);
+    samplerSecondaryHead += (secondaryPos - samplerSecondaryLastPos) & (SAMPLE_RING_SIZE - 1);
+    samplerSecondaryLastPos = secondaryPos;
+    // Only count a sample once everything before it in the merged order has arrived.
+    uint32_t primary = samplerPrimaryHead - samplerPrimaryOffset;
+    uint32_t secondary = samplerSecondaryHead - samplerSecondaryOffset;
+    samplerHead = samplerMergeBase + min(primary, secondary + 1) + min(secondary, primary);
+    return samplerHead;
+}
+
+// Spins until the DMA delivers the next ADC1 conversion and returns its (ADC1) index together with the
+// cycle counter right after it landed. Returns false if nothing arrives within 'timeoutCycles'.
+bool samplerWaitForConversion(uint32_t timeoutCycles, uint32_t& outIndex, uint32_t& outCycles) {
+    samplerRefresh();
+    uint32_t last = samplerPrimaryHead;
+    uint32_t start = timestampNow();
+    while (samplerRefresh(), (outIndex = samplerPrimaryHead) == last) {
+        if (timestampNow() - start > timeoutCycles) return false;
+    }
+    outCycles = timestampNow();
+    return true;
+}
+
+// Replaces the boot estimate of the conversion rate with one over SAMPLE_RATE_REFINE_MICROS, without
+// blocking: called between runs, it counts ADC1 samples from the reference taken on boot. Between runs
+// the ring may lap unobserved, but only whole laps go missing and the boot estimate predicts the count
+// to far better than half a lap, so they are added back. The reference is renewed when it gets too old
+// for the cycle counter (which wraps after ~7 s). The hardware detector pauses the DMA during runs,
+// so there the boot estimate stays.
+void samplerRefineRate() {
+    if (samplerRateRefined || ENABLE_HARDWARE_EDGE_DETECT) return;
+    uint32_t index, cycles;
+    if (!samplerWaitForConversion(microsToCycles(1000), index, cycles)) return;
+    if (millis() - samplerRateRefMillis > SAMPLE_RATE_REFINE_MICROS / 1000 * 4) {
+        samplerRateRefIndex = index;
+        samplerRateRefCycles = cycles;
+        samplerRateRefMillis = millis();
+        return;
+    }
+    uint32_t elapsedCycles = cycles - samplerRateRefCycles;
+    if (elapsedCycles < microsToCycles(SAMPLE_RATE_REFINE_MICROS)) return;
+
+    double expected = elapsedCycles / (double)samplerPrimaryCyclesPerSample;
+    uint32_t observed = index - samplerRateRefIndex;
+    double laps = round((expected - observed) / SAMPLE_RING_SIZE);
+    double sampleCount = observed + laps * SAMPLE_RING_SIZE;
+    float refined = (float)(elapsedCycles / sampleCount);
+    samplerIntervalMicros *= refined / samplerPrimaryCyclesPerSample;
+    samplerPrimaryCyclesPerSample = refined;
+    samplerCyclesPerSample = ENABLE_INTERLEAVED_SAMPLING ? refined / 2.0f : refined;
+    samplerRateRefined = true;
+}
+
+// Reads a sample by its absolute (merged) index.
+FASTRUN uint8_t samplerAt(uint32_t index) {
+    if (!ENABLE_INTERLEAVED_SAMPLING || !samplerInterleaved) return sampleRing[index & (SAMPLE_RING_SIZE - 1)];
+    int32_t offset = (int32_t)(index - samplerMergeBase);
+    if (offset < 0) return sampleRing[(samplerPrimaryHead - 1) & (SAMPLE_RING_SIZE - 1)]; // Older segment, long gone
+    if (offset & 1) return sampleRingSecondary[(samplerSecondaryOffset + (offset >> 1)) & (SAMPLE_RING_SIZE - 1)];
+    return sampleRing[(samplerPrimaryOffset + (offset >> 1)) & (SAMPLE_RING_SIZE - 1)];
+}
+
+// Discards any backlog, re-anchors sample indices to the cycle counter and returns the index of the
+// next sample to be converted. Call this right before timestamping a click.
+FASTRUN uint32_t samplerSync() {
+    // Read the DMA position and the cycle counter back-to-back so the pair describes one instant.
+    noInterrupts();
+    samplerCursor = samplerRefresh();
+    samplerAnchorCycles = timestampNow();
+    interrupts();
+    samplerAnchorIndex = samplerCursor;
+    samplerOverrun = false;
+    return samplerCursor;
+}
+
+// Pops the next unread sample. Returns false if the consumer has caught up with the DMA.
+FASTRUN bool samplerNext(uint8_t& value) {
+    if (samplerCursor == samplerHead && samplerCursor == samplerRefresh()) return false;
+
+    // The DMA is about to overwrite the slot we want, the data in between is lost.
+    if (samplerHead - samplerCursor > SAMPLER_SPAN - 16) {
+        samplerOverrun = true;
+        samplerCursor = samplerHead - 1;
+    }
+    value = samplerAt(samplerCursor);
+    samplerCursor++;
+    return true;
+}
+
+// Returns the most recently converted light sensor value.
+FASTRUN int samplerLatest() {
+    return samplerAt(samplerRefresh() - 1);
+}
+
+// Moving average (EDGE_FILTER_MODE 2) or median (3) of the EDGE_FILTER_WINDOW samples up to 'index'.
+// The samples of a window stay in the ring, so callers can go back to the raw values behind a level.
+// Reads the history straight from the ring, which reaches far further back than any window.
+FASTRUN float edgeFilterLevel(uint32_t index) {
+    uint8_t window[EDGE_FILTER_WINDOW];
+    for (int k = 0; k < EDGE_FILTER_WINDOW; k++) window[k] = samplerAt(index - k);
+    if (EDGE_FILTER_MODE == 2) {
+        int sum = 0;
+        for (int k = 0; k < EDGE_FILTER_WINDOW; k++) sum += window[k];
+        return (float)sum / EDGE_FILTER_WINDOW;
+    }
+    // Insertion sort, the window is tiny
+    for (int k = 1; k < EDGE_FILTER_WINDOW; k++) {
+        uint8_t v = window[k];
+        int j = k;
+        for (; j > 0 && window[j - 1] > v; j--) window[j] = window[j - 1];
+        window[j] = v;
+    }
+    return window[EDGE_FILTER_WINDOW / 2];
+}
+
+// N-of-M (EDGE_FILTER_MODE 1): true if at least EDGE_FILTER_CONFIRM of the last EDGE_FILTER_WINDOW samples
+// up to 'index', and not before 'firstIndex', are past the threshold. 'outEdge' is then the oldest of them.
+template <bool WaitForLight>
+FASTRUN bool edgeFilterConfirmed(uint32_t index, uint32_t firstIndex, int threshold, uint32_t& outEdge) {
+    int count = 0;
+    for (int k = 0; k < EDGE_FILTER_WINDOW && (int32_t)(index - k - firstIndex) >= 0; k++) {
+        uint8_t value = samplerAt(index - k);
+        if (WaitForLight ? (value >= threshold) : (value <= threshold)) {
+            count++;
+            outEdge = index - k;
+        }
+    }
+    return count >= EDGE_FILTER_CONFIRM;
+}
+
+// Consumes samples from 'fromIndex' onwards until the (filtered, see EDGE_FILTER_MODE) signal crosses the
+// light (>=) or dark (<=) threshold. On success 'outIndex' holds the absolute index of the first crossing
+// sample and 'outFraction' where between the previous sample (0) and that one (1) the signal passed the
+// threshold, interpolated linearly from the two values. Without a previous sample, or with interpolation
+// off, it is 1. The filter delay is already removed from both.
+// Returns false on timeout, or if samples were lost and the edge position can't be trusted.
+template <bool WaitForLight>
+bool samplerWaitForCrossing(uint32_t fromIndex, unsigned long timeoutMicros, uint32_t& outIndex, float& outFraction) {
+    samplerCursor = fromIndex;
+    const uint32_t timeoutCycles = microsToCycles(timeoutMicros);
+    const uint32_t startCycles = timestampNow();
+    const int threshold = WaitForLight ? settings.lightThreshold : settings.darkThreshold;
+    const float armLevel = WaitForLight ? threshold - EDGE_FILTER_HYSTERESIS : threshold + EDGE_FILTER_HYSTERESIS;
+    bool armed = (EDGE_FILTER_HYSTERESIS == 0);
+    uint32_t armedIndex = fromIndex;
+    // The averaging filters look back into the ring, so their level right after the click is already valid.
+    float previous = (EDGE_FILTER_MODE >= 2) ? edgeFilterLevel(fromIndex - 1) : -1.0f;
+    uint8_t value;
+    while (true) {
+        while (samplerNext(value)) {
+            uint32_t index = samplerCursor - 1;
+            float level = (EDGE_FILTER_MODE >= 2) ? edgeFilterLevel(index) : value;
+            if (!armed) {
+                armed = WaitForLight ? (level <= armLevel) : (level >= armLevel);
+                armedIndex = index + 1;
+                previous = level;
+                continue;
+            }
+
+            bool crossed;
+            if (EDGE_FILTER_MODE == 1) {
+                crossed = edgeFilterConfirmed<WaitForLight>(index, armedIndex, threshold, index);
+                if (crossed) {
+                    // Interpolate towards the sample before the oldest confirming one, if it is on the other side.
+                    level = samplerAt(index);
+                    uint8_t before = samplerAt(index - 1);
+                    bool otherSide = WaitForLight ? (before < threshold) : (before > threshold);
+                    previous = ((int32_t)(index - armedIndex) > 0 && otherSide) ? before : -1.0f;
+                }
+            } else {
+                crossed = WaitForLight ? (level >= threshold) : (level <= threshold);
+                if (crossed && EDGE_FILTER_MODE == 2) {
+                    // The mean only confirms the edge. Its lag behind the raw crossing depends on the step
+                    // height, so the edge is the last raw crossing inside the window (or the mean's own
+                    // crossing if the raw samples never cross there, e.g. a slow ramp through noise).
+                    for (int k = 0; k < EDGE_FILTER_WINDOW - 1 && (int32_t)(index - k - armedIndex) > 0; k++) {
+                        uint8_t raw = samplerAt(index - k);
+                        uint8_t before = samplerAt(index - k - 1);
+                        bool rawPast = WaitForLight ? (raw >= threshold) : (raw <= threshold);
+                        bool beforePast = WaitForLight ? (before >= threshold) : (before <= threshold);
+                        if (rawPast && !beforePast) {
+                            index -= k;
+                            level = raw;
+                            previous = before;
+                            break;
+                        }
+                    }
+                }
+            }
+            if (crossed) {
+                float fraction = 1.0f;
+                // 'previous' is on the other side of the threshold, so the step is never zero.
+                if (ENABLE_EDGE_INTERPOLATION && previous >= 0) {
+                    fraction = (threshold - previous) / (level - previous);
+                }
+                // Move the edge back by the filter delay, keeping the fraction in (0, 1].
+                float position = fraction - EDGE_FILTER_DELAY_SAMPLES;
+                int32_t shift = (int32_t)ceilf(position) - 1;
+                outIndex = index + shift;
+                outFraction = position - shift;
+                return !samplerOverrun;
+            }
+            previous = level;
+        }
+        // The extra sensors are served whenever the ring is drained, their readings carry own timestamps.
+        if (SCAN_CHANNEL_COUNT > 0 && extraSensorScanActive) extraSensorScanStep();
+        // Only check the clock once the ring is drained, the stream itself is the timebase.
+        if (timestampNow() - startCycles > timeoutCycles) return false;
+    }
+}
+
+// Returns the cycle counter time at which the sample with the given index completed.
+// The anchor index was still converting when it was taken, so on average it completes half an
+// interval later; the 0.5 removes that bias. Double precision keeps sub-cycle accuracy even
+// near the 1 second timeout (the M7 FPU handles doubles in hardware).
+// Interleaved ADC2 samples sit 'samplerPhaseSkew' off the midpoint between their ADC1 neighbours;
+// averaged over the unknown parity of the anchor that moves odd indices +skew/2 and even ones -skew/2.
+FASTRUN uint32_t samplerIndexToCycles(uint32_t index) {
+    double skew = ((index - samplerMergeBase) & 1) ? 0.5 * samplerPhaseSkew : -0.5 * samplerPhaseSkew;
+    return samplerAnchorCycles + (uint32_t)(((int32_t)(index - samplerAnchorIndex) + 0.5) * (double)samplerCyclesPerSample + skew);
+}
+
+// Latency in cycles from a click timestamp to the threshold crossing. 'fraction' (see
+// samplerWaitForCrossing) moves the edge back from 'edgeIndex' towards the previous sample.
+FASTRUN uint32_t samplerLatencyCycles(uint32_t clickCycles, uint32_t edgeIndex, float fraction) {
+    uint32_t edgeCycles = samplerIndexToCycles(edgeIndex);
+    uint32_t stepCycles = edgeCycles - samplerIndexToCycles(edgeIndex - 1); // Uneven when interleaved
+    edgeCycles -= (uint32_t)((1.0f - fraction) * stepCycles);
+    int32_t latency = (int32_t)(edgeCycles - clickCycles);
+    return latency > 0 ? (uint32_t)latency : 0;
+}
+
+// --- Edge Detection ---
+// Two interchangeable back-ends for "wait until the sensor crosses a threshold after a click":
+//  - Software: scan the DMA sample ring (default).
+//  - Hardware: program the threshold into ADC1's compare unit. Conversions that don't satisfy the
+//    compare never raise COCO, so the first conversion-complete interrupt IS the crossing and the
+//    ISR timestamps it. No software loop sits in the critical path.
+// Usage is always: index = edgeDetectArm(dir); t = timestampNow(); <click>; edgeDetectWait(...).
+
+// ADC1 conversion-complete ISR, only enabled while the hardware detector is armed.
+FASTRUN void hardwareEdgeIsr() {
+    hwEdgeCycles = ARM_DWT_CYCCNT;
+    (void)ADC1_R0; // Reading the result clears COCO
+    hwEdgeLatched = true;
+    // Every following conversion matches too, mask the IRQ until edgeDetectWait() disarms it.
+    NVIC_DISABLE_IRQ(IRQ_ADC1);
+}
+
+// Prepares the selected detector. Returns the sample index to hand back to edgeDetectWait().
+uint32_t edgeDetectArm(bool waitForLight) {
+    if (!ENABLE_HARDWARE_EDGE_DETECT) return samplerSync();
+
+    hwEdgeLatched = false;
+    adc->adc0->disableDMA(); // The DMA would otherwise consume COCO before the interrupt sees it
+    if (waitForLight) {
+        adc->adc0->enableCompare(settings.lightThreshold, true);       // Match when result >= LIGHT
+    } else {
+        adc->adc0->enableCompare(settings.darkThreshold + 1, false);   // Match when result <= DARK
+    }
+    (void)ADC1_R0; // Clear a COCO left over from a conversion that finished before compare was enabled
+    adc->adc0->enableInterrupts(hardwareEdgeIsr, 0); // Highest priority for a tight timestamp
+    return 0;
+}
+
+// Waits for the armed detector to see the crossing. On success 'run' holds the latency from
+// 'clickCycles' to the crossing and the number of samples in between. Returns false on timeout or lost samples.
+template <bool WaitForLight>
+bool edgeDetectWait(uint32_t clickIndex, uint32_t clickCycles, RunResult& run) {
+    if (!ENABLE_HARDWARE_EDGE_DETECT) {
+        uint32_t edgeIndex;
+        float edgeFraction;
+        if (!samplerWaitForCrossing<WaitForLight>(clickIndex, settings.measurementTimeoutMicros, edgeIndex, edgeFraction)) return false;
+        run.latencyCycles = samplerLatencyCycles(clickCycles, edgeIndex, edgeFraction);
+        run.sampleCount = edgeIndex - clickIndex + 1;
+        run.edgeIndex = edgeIndex;
+        return true;
+    }
+
+    // The core has nothing to do in the window, the ADC and ISR do the work.
+    // We deliberately don't WFI here: the cycle counter halts while the core clock is gated.
+    const uint32_t timeoutCycles = microsToCycles(settings.measurementTimeoutMicros);
+    while (!hwEdgeLatched && timestampNow() - clickCycles < timeoutCycles) {
+        if (SCAN_CHANNEL_COUNT > 0 && extraSensorScanActive) extraSensorScanStep();
+    }
+
+    // Disarm and hand ADC1 back to the DMA sample stream.
+    adc->adc0->disableInterrupts();
+    adc->adc0->disableCompare();
+    adc->adc0->enableDMA();
+    samplerSync();
+
+    if (!hwEdgeLatched) return false;
+    int32_t latency = (int32_t)(hwEdgeCycles - clickCycles);
+    run.latencyCycles = latency > 0 ? (uint32_t)latency : 0;
+    // Conversions aren't stored in this mode, derive the count from the measured conversion rate.
+    run.sampleCount = (uint32_t)(run.latencyCycles / samplerCyclesPerSample) + 1;
+    return true;
+}
+
+// --- Measurement Kernel ---
+// Every mode is the same measurement with two things swapped: how the click is sent (PinClick through
+// the mouse switch, UsbClick as a HID report) and which way the screen changes. Both are template
+// parameters, so each mode gets its own copy of the edge detector with the direction and click path
+// resolved at compile time and no runtime branch between the click timestamp and the crossing.
+// Teensy 4 runs all code from ITCM unless marked FLASHMEM, so the instantiations sit in the same
+// tightly coupled memory as the FASTRUN functions. (FASTRUN itself is avoided on templates: section
+// attributes on COMDAT instantiations clash with the plain FASTRUN functions in one translation unit.)
+
+uint32_t PinClick::press(RunResult& run) {
+    uint32_t clickCycles = timestampNow();
+    digitalWriteFast(PIN_SEND_CLICK, HIGH);
+    return clickCycles;
+}
+
+void PinClick::release() {
+    digitalWriteFast(PIN_SEND_CLICK, LOW);
+}
+
+uint32_t PinClick::tap(RunResult& run) {
+    uint32_t clickCycles = press(run);
+    delayMicroseconds(settings.clickHoldMicros);
+    release();
+    return clickCycles;
+}
+
+void PinClick::toggle() {
+    sendToggleClick(false);
+}
+
+uint32_t UsbClick::press(RunResult& run) {
+    return usbSendSynced(UsbAction::PRESS, run);
+}
+
+void UsbClick::release() {
+    Mouse.release(MOUSE_LEFT);
+}
+
+uint32_t UsbClick::tap(RunResult& run) {
+    return usbSendSynced(UsbAction::CLICK, run);
+}
+
+void UsbClick::toggle() {
+    sendToggleClick(true);
+}
+
+uint32_t UsbMotion::press(RunResult& run) {
+    return tap(run);
+}
+
+void UsbMotion::release() {}
+
+uint32_t UsbMotion::tap(RunResult& run) {
+    uint32_t clickCycles = usbSendSynced(motionAtStart ? UsbAction::MOVE_FORWARD : UsbAction::MOVE_BACK, run);
+    motionAtStart = !motionAtStart;
+    return clickCycles;
+}
+
+void UsbMotion::toggle() {
+    usb_mouse_move(motionAtStart ? MOTION_STEP_X : -MOTION_STEP_X, motionAtStart ? MOTION_STEP_Y : -MOTION_STEP_Y, 0, 0);
+    motionAtStart = !motionAtStart;
+}
+
+// Times one click: arm the detector, click, wait for the crossing. HoldUntilEdge keeps the button down
+// until the screen has changed (Auto modes, extra sensors included), otherwise the click is a tap (UE4).
+template <typename Click, bool WaitForLight, bool HoldUntilEdge>
+bool measureTransition(RunResult& run) {
+    run.framePhase = framePhaseWait(); // Before arming, the wait is up to one frame
+    uint32_t clickIndex = edgeDetectArm(WaitForLight);
+    if (HoldUntilEdge && SCAN_CHANNEL_COUNT > 0) extraSensorScanBegin();
+    uint32_t issueCycles = timestampNow();
+    uint32_t clickCycles = HoldUntilEdge ? Click::press(run) : Click::tap(run);
+    run.clickIssueCycles = clickCycles - issueCycles;
+    if (!HoldUntilEdge) run.clickHoldCycles = timestampNow() - clickCycles; // tap() returns after the release
+
+    bool detected = edgeDetectWait<WaitForLight>(clickIndex, clickCycles, run);
+
+    if (HoldUntilEdge) {
+        // The other screen positions light up later in the scanout, keep the click held until they have.
+        // The sound doesn't need the button: it is released first, so a click nobody hears isn't a
+        // drag of a whole timeout in game.
+        if (EXTRA_LIGHT_SENSOR_COUNT > 0) extraSensorScanWaitForLight(clickCycles);
+        Click::release();
+        run.clickHoldCycles = timestampNow() - clickCycles;
+        if (SCAN_CHANNEL_COUNT > 0) extraSensorScanFinish(clickCycles);
+    }
+    return detected;
+}
+
+// One Auto mode measurement: wait for a dark screen, then time a held click to the screen turning white.
+template <typename Click>
+AutoMeasureResult performAutoModeMeasurement(RunResult& outRun) {
+    // --- SYNC STEP ---
+    // We wait until the screen has been continuously dark.
+    uint32_t syncStartCycles = timestampNow();
+    elapsedMicros overallSyncTimer;
+    while (samplerLatest() > settings.darkThreshold || (SCAN_CHANNEL_COUNT > 0 && !extraSensorsDark())) {
+        if (overallSyncTimer > settings.measurementTimeoutMicros) {
+            phaseStats.syncTimeouts++;
+            return AutoMeasureResult::TIMEOUT;
+        }
+        if (buttonHoldRequested()) {
+            phaseStats.aborts++;
+            return AutoMeasureResult::ABORT;
+        }
+    }
+    outRun.syncWaitCycles = timestampNow() - syncStartCycles;
+
+    // --- MEASUREMENT STEP ---
+    if (!measureTransition<Click, true, true>(outRun)) {
+        phaseStats.edgeTimeouts++;
+        return AutoMeasureResult::TIMEOUT;
+    }
+    return AutoMeasureResult::SUCCESS;
+}
+
+// Shared by the mode runners: while the next run isn't due, check for a hold and do the idle work.
+// Returns true if the pass should end here.
+bool runSchedulerWaiting() {
+    if (runSchedulerDue()) return false;
+    if (debouncer.read() == LOW && debouncer.currentDuration() > BUTTON_HOLD_START_MS) {
+        previousState = currentState;
+        currentState = State::HOLD_ACTION;
+        return true;
+    }
+    runSchedulerIdle();
+    return true;
+}
+
+// One pass of an Auto mode: run limit check, measurement, stats and scheduling the next run.
+// Between runs the pass returns at once, so loop() never blocks outside the measurement itself.
+template <typename Click>
+void runAutoMode(LatencyStats& stats) {
+    if (runSchedulerWaiting()) return;
+
+    // Check if run limit has been reached BEFORE performing the next measurement.
+    if (runLimitReached(stats, nullptr)) {
+        currentState = State::RUNS_COMPLETE;
+        return;
+    }
+
+    RunResult run;
+    AutoMeasureResult result = performAutoModeMeasurement<Click>(run);
+
+    if (result == AutoMeasureResult::SUCCESS) {
+        updateStats(stats, Transition::DARK_TO_LIGHT, run);
+        updateExtraSensorStats(run, stats.runCount);
+    } else if (result == AutoMeasureResult::ABORT) {
+        previousState = currentState;
+        currentState = State::HOLD_ACTION;
+        return;
+    }
+    // On TIMEOUT, we just loop and try again.
+
+    // The stats are redrawn by updateDisplay() at the end of loop(); the pages go out while waiting.
+    runSchedulerArm(settings.autoRunDelayMs);
+}
+
+// One pass of a UE4 Aperture mode. Every click toggles the screen, so passes alternate between
+// B-to-W and W-to-B measurements.
+template <typename Click>
+void runUe4Mode(LatencyStats& bToWStats, LatencyStats& wToBStats) {
+    if (runSchedulerWaiting()) return;
+
+    // Check if run limit has been reached.
+    if (runLimitReached(bToWStats, &wToBStats)) {
+        currentState = State::RUNS_COMPLETE;
+        return;
+    }
+
+    // On the first run, perform sync AND a warm-up cycle.
+    if (isFirstUe4Run) {
+        SyncResult syncResult = performSmartSync<Click>();
+
+        if (syncResult == SyncResult::HOLD_ABORT) {
+            phaseStats.aborts++;
+            previousState = currentState;
+            currentState = State::HOLD_ACTION;
+            return;
+        }
+        if (syncResult == SyncResult::FAILED) phaseStats.smartSyncRetries++;
+
+        if (syncResult == SyncResult::SUCCESS) {
+            // --- WARM-UP CYCLE ---
+            drawSyncScreen("Warming up...", 32);
+
+            // Warm-up 1: B-to-W (don't measure)
+            Click::toggle();
+            elapsedMicros warmupTimer;
+            while (samplerLatest() < settings.lightThreshold && warmupTimer < settings.measurementTimeoutMicros);
+            delayWithJitterAndAbortCheck(settings.ue4RunDelayMs);
+
+            // Warm-up 2: W-to-B (don't measure)
+            Click::toggle();
+            warmupTimer = 0;
+            while (samplerLatest() > settings.darkThreshold && warmupTimer < settings.measurementTimeoutMicros);
+            delayWithJitterAndAbortCheck(settings.ue4RunDelayMs);
+
+            isFirstUe4Run = false;         // Sync and warm-up complete.
+            ue4_isWaitingForWhite = true;  // We ended on DARK, so we expect WHITE next.
+        }
+        // End this loop cycle. The next one will be the first REAL measurement.
+        return;
+    }
+
+    // --- This is the normal measurement logic, which only runs on a "hot" system ---
+    bool timeoutOccurred = false;
+    uint32_t syncStartCycles = timestampNow();
+    elapsedMicros syncTimer;
+    if (ue4_isWaitingForWhite) {
+        while (samplerLatest() > settings.darkThreshold) {
+            if (syncTimer > settings.measurementTimeoutMicros) { timeoutOccurred = true; break; }
+            if (buttonHoldRequested()) { phaseStats.aborts++; previousState = currentState; currentState = State::HOLD_ACTION; return; }
+        }
+    } else {
+        while (samplerLatest() < settings.lightThreshold) {
+            if (syncTimer > settings.measurementTimeoutMicros) { timeoutOccurred = true; break; }
+            if (buttonHoldRequested()) { phaseStats.aborts++; previousState = currentState; currentState = State::HOLD_ACTION; return; }
+        }
+    }
+    if (timeoutOccurred) {
+        phaseStats.syncTimeouts++;
+        runSchedulerArm(settings.ue4RunDelayMs, !ue4_isWaitingForWhite);
+        return;
+    }
+
+    RunResult run;
+    run.syncWaitCycles = timestampNow() - syncStartCycles;
+    if (ue4_isWaitingForWhite) {
+        if (measureTransition<Click, true, false>(run)) {
+            waveformAfterRun(run, Transition::DARK_TO_LIGHT, bToWStats.runCount + 1);
+            updateStats(bToWStats, Transition::DARK_TO_LIGHT, run);
+            ue4_isWaitingForWhite = false;
+        } else {
+            phaseStats.edgeTimeouts++;
+        }
+    } else {
+        if (measureTransition<Click, false, false>(run)) {
+            waveformAfterRun(run, Transition::LIGHT_TO_DARK, wToBStats.runCount + 1);
+            updateStats(wToBStats, Transition::LIGHT_TO_DARK, run);
+            ue4_isWaitingForWhite = true;
+        } else {
+            phaseStats.edgeTimeouts++;
+        }
+    }
+
+    runSchedulerArm(settings.ue4RunDelayMs, !ue4_isWaitingForWhite);
+}
+
+// --- Multi-Sensor Scan ---
+// In the Auto modes the extra sensors are converted one after another on ADC2 while the main detector
+// runs on ADC1's stream. A conversion is started and then checked whenever the main detector has
+// drained the sample ring, so neither side blocks the other. Each sensor's edge is interpolated between
+// its own last two readings. Once the main edge is found the scan continues alone until every sensor
+// has seen its edge or the measurement times out. The audio channel takes the slot after the light
+// sensors (AUDIO_SCAN_CHANNEL), with the sound and quiet levels as its light and dark thresholds.
+
+int extraSensorPin(int channel) {
+    return (ENABLE_AUDIO_CHANNEL && channel == AUDIO_SCAN_CHANNEL) ? PIN_AUDIO_INPUT : EXTRA_LIGHT_SENSOR_PINS[channel];
+}
+
+int extraSensorLightThreshold(int sensor) {
+    if (ENABLE_AUDIO_CHANNEL && sensor == AUDIO_SCAN_CHANNEL) return AUDIO_THRESHOLD;
+    int threshold = EXTRA_LIGHT_SENSOR_LIGHT_THRESHOLDS[sensor];
+    return threshold > 0 ? threshold : settings.lightThreshold;
+}
+
+int extraSensorDarkThreshold(int sensor) {
+    if (ENABLE_AUDIO_CHANNEL && sensor == AUDIO_SCAN_CHANNEL) return AUDIO_QUIET_THRESHOLD;
+    int threshold = EXTRA_LIGHT_SENSOR_DARK_THRESHOLDS[sensor];
+    return threshold > 0 ? threshold : settings.darkThreshold;
+}
+
+// True if no extra sensor is above its dark threshold and the sound has decayed, checked before every
+// Auto mode click.
+bool extraSensorsDark() {
+    for (int i = 0; i < SCAN_CHANNEL_COUNT; i++) {
+        if (fastAnalogRead(extraSensorPin(i)) > extraSensorDarkThreshold(i)) return false;
+    }
+    return true;
+}
+
+void extraSensorScanBegin() {
+    for (int i = 0; i < SCAN_CHANNEL_COUNT; i++) {
+        extraSensorScan[i].detected = false;
+        extraSensorScan[i].previous = -1;
+        extraSensorScan[i].readingCount = 0;
+    }
+    extraSensorConverting = -1;
+    extraSensorScanActive = true;
+}
+
+// Collects a finished conversion and starts the next one. Returns true once every sensor saw its edge.
+FASTRUN bool extraSensorScanStep() {
+    if (extraSensorConverting >= 0) {
+        if (!adc->adc1->isComplete()) return false;
+        uint32_t now = timestampNow();
+        ExtraSensorScan& scan = extraSensorScan[extraSensorConverting];
+        int value = adc->adc1->readSingle();
+        int threshold = extraSensorLightThreshold(extraSensorConverting);
+        scan.readingCount++;
+        if (value >= threshold) {
+            scan.detected = true;
+            scan.edgeCycles = now;
+            if (ENABLE_EDGE_INTERPOLATION && scan.previous >= 0) {
+                float fraction = (float)(threshold - scan.previous) / (float)(value - scan.previous);
+                scan.edgeCycles = scan.previousCycles + (uint32_t)(fraction * (now - scan.previousCycles));
+            }
+        }
+        scan.previous = value;
+        scan.previousCycles = now;
+    }
+
+    // Round-robin over the sensors still waiting for their edge.
+    int next = -1;
+    for (int step = 1; step <= SCAN_CHANNEL_COUNT; step++) {
+        int candidate = extraSensorConverting + step;
+        if (candidate >= SCAN_CHANNEL_COUNT) candidate -= SCAN_CHANNEL_COUNT;
+        if (!extraSensorScan[candidate].detected) {
+            next = candidate;
+            break;
+        }
+    }
+    extraSensorConverting = next;
+    if (next < 0) return true;
+    adc->adc1->startSingleRead(extraSensorPin(next));
+    return false;
+}
+
+// Scans on after the main edge until every extra light sensor saw its edge or the measurement timed
+// out. The audio channel keeps being scanned alongside, extraSensorScanFinish() waits for the rest of it.
+void extraSensorScanWaitForLight(uint32_t clickCycles) {
+    const uint32_t timeoutCycles = microsToCycles(settings.measurementTimeoutMicros);
+    while (timestampNow() - clickCycles < timeoutCycles) {
+        bool lightDone = true;
+        for (int i = 0; i < EXTRA_LIGHT_SENSOR_COUNT; i++) lightDone = lightDone && extraSensorScan[i].detected;
+        if (lightDone || extraSensorScanStep()) return;
+    }
+}
+
+// Scans on after the main edge until every extra sensor saw its edge or the measurement timed out.
+void extraSensorScanFinish(uint32_t clickCycles) {
+    const uint32_t timeoutCycles = microsToCycles(settings.measurementTimeoutMicros);
+    while (!extraSensorScanStep() && timestampNow() - clickCycles < timeoutCycles);
+    extraSensorScanActive = false;
+
+    // Leave ADC2 idle for the next fastAnalogRead().
+    if (extraSensorConverting >= 0) {
+        while (!adc->adc1->isComplete());
+        (void)adc->adc1->readSingle();
+        extraSensorConverting = -1;
+    }
+
+    for (int i = 0; i < SCAN_CHANNEL_COUNT; i++) {
+        ExtraSensorScan& scan = extraSensorScan[i];
+        if (scan.detected) {
+            int32_t latency = (int32_t)(scan.edgeCycles - clickCycles);
+            scan.edgeCycles = latency > 0 ? (uint32_t)latency : 0; // From here on: latency from the click
+        }
+    }
+}
+
+// Records one run per extra sensor that saw the edge of the click measured in 'mainRun', and the
+// click-to-sound run if the sound was heard. Sound runs are logged under 'mainRunIndex', the light run of
+// the same click, so both latencies of a click can be paired up.
+void updateExtraSensorStats(const RunResult& mainRun, unsigned long mainRunIndex) {
+    for (int i = 0; i < EXTRA_LIGHT_SENSOR_COUNT; i++) {
+        if (!extraSensorScan[i].detected) continue;
+        RunResult run = mainRun; // Same click, sync wait and USB timing
+        run.latencyCycles = extraSensorScan[i].edgeCycles;
+        run.sampleCount = extraSensorScan[i].readingCount;
+        run.sensor = i + 1;
+        updateStats(statsExtraSensors[i], Transition::DARK_TO_LIGHT, run);
+    }
+    if (ENABLE_AUDIO_CHANNEL && extraSensorScan[AUDIO_SCAN_CHANNEL].detected) {
+        RunResult run = mainRun;
+        run.latencyCycles = extraSensorScan[AUDIO_SCAN_CHANNEL].edgeCycles;
+        run.sampleCount = extraSensorScan[AUDIO_SCAN_CHANNEL].readingCount;
+        run.sensor = LOG_SENSOR_AUDIO;
+        run.logRunIndex = mainRunIndex;
+        updateStats(statsAudio, Transition::DARK_TO_LIGHT, run);
+    }
+}
+
+// --- Helper function to centralize statistics calculations ---
+void updateStats(LatencyStats& stats, Transition direction, const RunResult& run) {
+    // Cycles are converted only here, everything upstream keeps the raw counter resolution.
+    float latencyMillis = cyclesToMicros(run.latencyCycles) / 1000.0f;
+
+    // Update the provided stats struct
+    stats.runCount++;
+
+    // Keep the raw value in the PSRAM store and stream it to the SD log if enabled
+    LogRecord record;
+    record.timestampMs = millis();
+    record.latencyCycles = run.latencyCycles;
+    record.runIndex = run.logRunIndex ? run.logRunIndex : stats.runCount;
+    record.mode = getLogModeCode(currentState);
+    record.direction = (uint8_t)direction;
+    record.flags = (run.usbOffsetValid ? LOG_FLAG_USB_OFFSET : 0) | (run.usbPhased ? LOG_FLAG_USB_PHASED : 0) |
+                   (run.framePhase >= 0.0f ? LOG_FLAG_FRAME_PHASED : 0);
+    record.usbOffsetCycles = run.usbOffsetCycles;
+    record.sensor = run.sensor;
+    record.framePhase = run.framePhase >= 0.0f ? (uint8_t)min(255, (int)(run.framePhase * 256.0f)) : 0;
+    memset(record.reservedBytes, 0, sizeof(record.reservedBytes));
+    record.syncWaitCycles = run.syncWaitCycles;
+    record.sampleCount = run.sampleCount;
+    runStoreAppend(record);
+    if (ENABLE_SD_LOGGING && sdCardPresent) {
+        sdLoggerAppend(record);
+    }
+    if (ENABLE_SERIAL_TELEMETRY) {
+        telemetrySendRun(record, run);
+    }
+
+    stats.lastLatency = latencyMillis;
+    // Welford's update: a numerically stable running mean and sum of squared differences
+    float delta = latencyMillis - stats.avgLatency;
+    stats.avgLatency = stats.avgLatency + delta / stats.runCount;
+    stats.sumSquaredDiff += (double)delta * (latencyMillis - stats.avgLatency);
+    if (latencyMillis < stats.minLatency) stats.minLatency = latencyMillis;
+    if (latencyMillis > stats.maxLatency) stats.maxLatency = latencyMillis;
+
+    p2Add(stats.p50, latencyMillis);
+    p2Add(stats.p90, latencyMillis);
+    p2Add(stats.p99, latencyMillis);
+    stats.histogram[latencyHistogramBin(latencyMillis)]++;
+
+    if (run.usbOffsetValid) {
+        stats.usbOffsetCount++;
+        float usbOffsetMillis = cyclesToMicros(run.usbOffsetCycles) / 1000.0f;
+        stats.avgUsbOffsetMillis += (usbOffsetMillis - stats.avgUsbOffsetMillis) / stats.usbOffsetCount;
+    }
+
+    if (run.framePhase >= 0.0f) {
+        int slot = min((int)(run.framePhase * FRAME_PHASE_STRATA), FRAME_PHASE_STRATA - 1);
+        stats.phaseSlotCount[slot]++;
+        stats.phaseSlotMean[slot] += (latencyMillis - stats.phaseSlotMean[slot]) / stats.phaseSlotCount[slot];
+    }
+
+    if (run.sensor == 0) updatePhaseStats(run);
+}
+
+// Mean over the phase slot means, as if every slot had been hit equally often. 'spread' is the difference
+// between the slowest and fastest slot, roughly one frame when the pipeline is locked to the refresh.
+// Returns 0 without phase scheduled runs.
+float statsPhaseBalancedMean(const LatencyStats& stats, float& spread) {
+    float sum = 0.0f;
+    float lowest = 0.0f, highest = 0.0f;
+    int slots = 0;
+    for (int i = 0; i < FRAME_PHASE_STRATA; i++) {
+        if (stats.phaseSlotCount[i] == 0) continue;
+        float mean = stats.phaseSlotMean[i];
+        if (slots == 0 || mean < lowest) lowest = mean;
+        if (slots == 0 || mean > highest) highest = mean;
+        sum += mean;
+        slots++;
+    }
+    spread = highest - lowest;
+    return slots > 0 ? sum / slots : 0.0f;
+}
+
+// Extra sensor results share the main run's phases, so only main sensor runs are counted.
+void updatePhaseStats(const RunResult& run) {
+    PhaseStats& phases = phaseStats;
+    phases.runCount++;
+    float syncWaitMillis = cyclesToMicros(run.syncWaitCycles) / 1000.0f;
+    float clickIssueMicros = cyclesToMicros(run.clickIssueCycles);
+    float clickHoldMillis = cyclesToMicros(run.clickHoldCycles) / 1000.0f;
+
+    phases.avgSyncWaitMs += (syncWaitMillis - phases.avgSyncWaitMs) / phases.runCount;
+    phases.avgClickIssueMicros += (clickIssueMicros - phases.avgClickIssueMicros) / phases.runCount;
+    phases.avgClickHoldMs += (clickHoldMillis - phases.avgClickHoldMs) / phases.runCount;
+    phases.avgSamples += ((float)run.sampleCount - phases.avgSamples) / phases.runCount;
+    phases.maxSyncWaitMs = max(phases.maxSyncWaitMs, syncWaitMillis);
+    phases.maxClickIssueMicros = max(phases.maxClickIssueMicros, clickIssueMicros);
+    phases.maxSamples = max(phases.maxSamples, run.sampleCount);
+}
+
+// p50/p90/p99 (which = 0/1/2) in ms: exact once the session is finalized, streaming estimate before.
+float statsPercentile(const LatencyStats& stats, int which) {
+    if (stats.percentilesExact) return stats.exactPercentile[which];
+    const P2Quantile* estimators[] = {&stats.p50, &stats.p90, &stats.p99};
+    return p2Value(*estimators[which]);
+}
+
+// Sample standard deviation in ms, 0 until there are two runs.
+float statsStdDev(const LatencyStats& stats) {
+    if (stats.runCount < 2) return 0.0;
+    return (float)sqrt(stats.sumSquaredDiff / (stats.runCount - 1));
+}
+
+// Half-width in us of the 95% confidence interval of the mean latency, INFINITY until there are two runs.
+// Student's t comes from its first Cornish-Fisher correction to z, within 1% from 15 runs on.
+float statsMeanConfidenceMicros(const LatencyStats& stats) {
+    if (stats.runCount < 2) return INFINITY;
+    const float z = 1.96f;
+    float dof = stats.runCount - 1;
+    float t = z + (z * z * z + z) / (4 * dof);
+    return t * statsStdDev(stats) / sqrtf(stats.runCount) * 1000.0f;
+}
+
+// True once the session has all its runs: the run limit, or with the precision limit, the mean of every
+// direction known to within PRECISION_TARGET_MICROS. UE4 modes pass their W-to-B stats as 'other'.
+bool runLimitReached(const LatencyStats& stats, const LatencyStats* other) {
+    if (maxRuns > 0 && stats.runCount >= maxRuns) return true;
+    if (!precisionRunLimit) return false;
+
+    sessionPrecisionMicros = statsMeanConfidenceMicros(stats);
+    unsigned long runs = stats.runCount;
+    if (other) {
+        sessionPrecisionMicros = max(sessionPrecisionMicros, statsMeanConfidenceMicros(*other));
+        runs = min(runs, other->runCount);
+    }
+    return runs >= PRECISION_MIN_RUNS && sessionPrecisionMicros <= PRECISION_TARGET_MICROS;
+}
+
+// Feeds one observation into a P-squared estimator.
+void p2Add(P2Quantile& est, float value) {
+    float* q = est.height;
+    float* n = est.position;
+
+    // The first five observations seed the markers directly.
+    if (est.count < 5) {
+        q[est.count++] = value;
+        if (est.count == 5) {
+            std::sort(q, q + 5);
+            for (int i = 0; i < 5; i++) n[i] = i;
+            float p = est.quantile;
+            est.desired[0] = 0;
+            est.desired[1] = 2 * p;
+            est.desired[2] = 4 * p;
+            est.desired[3] = 2 + 2 * p;
+            est.desired[4] = 4;
+        }
+        return;
+    }
+    est.count++;
+
+    // Find the cell holding the new value, stretching the extremes if needed.
+    int k;
+    if (value < q[0]) {
+        q[0] = value;
+        k = 0;
+    } else if (value >= q[4]) {
+        q[4] = value;
+        k = 3;
+    } else {
+        k = 0;
+        while (k < 3 && value >= q[k + 1]) k++;
+    }
+
+    for (int i = k + 1; i < 5; i++) n[i] += 1;
+    float p = est.quantile;
+    const float increment[5] = {0, p / 2, p, (1 + p) / 2, 1};
+    for (int i = 0; i < 5; i++) est.desired[i] += increment[i];
+
+    // Nudge the three middle markers toward their desired positions.
+    for (int i = 1; i <= 3; i++) {
+        float d = est.desired[i] - n[i];
+        if ((d >= 1 && n[i + 1] - n[i] > 1) || (d <= -1 && n[i - 1] - n[i] < -1)) {
+            int s = (d > 0) ? 1 : -1;
+            // Piecewise-parabolic prediction, falling back to linear if it would break ordering.
+            float parabolic = q[i] + s / (n[i + 1] - n[i - 1]) *
+                ((n[i] - n[i - 1] + s) * (q[i + 1] - q[i]) / (n[i + 1] - n[i]) +
+                 (n[i + 1] - n[i] - s) * (q[i] - q[i - 1]) / (n[i] - n[i - 1]));
+            if (q[i - 1] < parabolic && parabolic < q[i + 1]) {
+                q[i] = parabolic;
+            } else {
+                q[i] = q[i] + s * (q[i + s] - q[i]) / (n[i + s] - n[i]);
+            }
+            n[i] += s;
+        }
+    }
+}
+
+// Current estimate. With fewer than five observations the exact nearest-rank value is returned.
+float p2Value(const P2Quantile& est) {
+    if (est.count == 0) return 0.0;
+    if (est.count >= 5) return est.height[2];
+
+    float sorted[5];
+    memcpy(sorted, est.height, est.count * sizeof(float));
+    std::sort(sorted, sorted + est.count);
+    int rank = (int)ceil(est.quantile * est.count) - 1;
+    return sorted[constrain(rank, 0, (int)est.count - 1)];
+}
+
+// --- Helper function to align text on the display ---
+void alignText(const char* text, int y, TextAlign align) {
+    int targetY;
+
+    // Check if a Y coordinate was provided. If not, use the current one.
+    if (y == -1) {
+        targetY = display.getCursorY();
+    } else {
+        targetY = y;
+    }
+
+    int16_t x1, y1;
+    uint16_t w, h;
+    display.getTextBounds(text, 0, 0, &x1, &y1, &w, &h);
+
+    int x = 0;
+    switch(align) {
+        case TextAlign::LEFT:
+            x = 0;
+            break;
+        case TextAlign::CENTER:
+            x = (SCREEN_WIDTH - w) / 2;
+            break;
+        case TextAlign::RIGHT:
+            x = SCREEN_WIDTH - w - 4;
+            break;
+    }
+
+    display.setCursor(max(0, x), targetY); // Use max(0, x) to prevent negative coordinates
+    display.println(text);
+}
+
+// --- Helper function to manage menu scrolling ---
+void updateScrollOffset(int selection, int& scrollOffset, int optionCount, int maxVisibleItems) {
+    // If selection moves above the visible window, adjust the window up.
+    if (selection < scrollOffset) {
+        scrollOffset = selection;
+    }
+    // If selection moves below the visible window, adjust the window down.
+    else if (selection >= scrollOffset + maxVisibleItems) {
+        scrollOffset = selection - maxVisibleItems + 1;
+    }
+
+    // This logic is mostly for safety, ensuring scrollOffset doesn't go out of bounds
+    // if the option count is smaller than the displayable item count.
+    if (optionCount <= maxVisibleItems) {
+        scrollOffset = 0;
+    } else if (scrollOffset > optionCount - maxVisibleItems) {
+        scrollOffset = optionCount - maxVisibleItems;
+    }
+}
+
+
+// --- Display Functions ---
+
+// Displays a formatted, full-screen error message and then pauses.
+void displayErrorScreen(const char* title, const char* line1, const char* line2, const char* line3, unsigned long delayMs) {
+    display.clearDisplay();
+    display.setTextSize(1);
+    display.setTextColor(SSD1306_WHITE);
+    alignText(title, 0);
+    display.drawLine(0, 8, SCREEN_WIDTH - 1, 8, SSD1306_WHITE);
+    if (line1) alignText(line1, 20);
+    if (line2) alignText(line2, 32);
+    if (line3) alignText(line3, 48);
+    rendererFlush();
+    delay(delayMs);
+}
+
+void updateDisplay() {
+    // Do not update the display from here if we are in setup mode, as it has its own display logic
+    if (currentState == State::SETUP) return;
+
+    // Measurement modes only redraw at a capped rate and never transmit from here,
+    // the renderer pushes the changed pages during the next inter-run delay.
+    bool isMeasuring = isMeasurementState(currentState);
+    if (isMeasuring) {
+        if (statsRefreshTimer < STATS_REFRESH_INTERVAL_MS) return;
+        statsRefreshTimer = 0;
+    }
+
+    display.clearDisplay();
+    display.setTextSize(1);
+    display.setTextColor(SSD1306_WHITE);
+
+    switch (currentState) {
+        case State::SELECT_MENU:
+            drawMenuScreen();
+            break;
+        case State::SELECT_RUN_LIMIT:
+            drawRunLimitMenuScreen();
+            break;
+        case State::SELECT_DEBUG_MENU:
+            drawDebugMenuScreen();
+            break;
+        case State::HOLD_ACTION:
+            drawHoldActionScreen();
+            break;
+        case State::AUTO_MODE:
+        case State::DIRECT_AUTO_MODE:
+        case State::AUTO_UE4_APERTURE:
+        case State::DIRECT_UE4_APERTURE:
+        case State::DIRECT_MOTION:
+        case State::RUNS_COMPLETE:
+            drawOperationScreen();
+            break;
+        case State::DEBUG_MOUSE:
+            drawMouseDebugScreen();
+            break;
+        case State::DEBUG_LSENSOR:
+            drawLightSensorDebugScreen();
+            break;
+        case State::DEBUG_CALIBRATE:
+            drawCalibrationScreen();
+            break;
+        case State::DEBUG_BENCHMARK:
+            drawBenchmarkScreen();
+            break;
+        default:
+            // Do not clear display in error state from here
+            break;
+    }
+    if (isMeasuring) {
+        rendererMarkDirty();
+    } else {
+        rendererFlush();
+    }
+}
+
+// --- Measurement Sessions ---
+// Shared by the menu/hold actions and the host START/STOP commands.
+
+bool isMeasurementState(State state) {
+    return state == State::AUTO_MODE || state == State::DIRECT_AUTO_MODE ||
+           state == State::AUTO_UE4_APERTURE || state == State::DIRECT_UE4_APERTURE ||
+           state == State::DIRECT_MOTION;
+}
+
+// Resets the stats of 'selectedMode', opens its log and enters it with the run limit in 'maxRuns'.
+void beginMeasurementSession() {
+    dataHasBeenSaved = false; // Reset save flag for the new run
+    for (int i = 0; i < MAX_EXTRA_LIGHT_SENSORS; i++) statsExtraSensors[i] = LatencyStats();
+    statsAudio = LatencyStats();
+    phaseStats = PhaseStats();
+    sessionPrecisionMicros = INFINITY;
+    waveformReset();
+    baselineReady = false;
+    if (selectedMode == State::AUTO_MODE) {
+        statsAuto = LatencyStats();
+    } else if (selectedMode == State::DIRECT_AUTO_MODE) {
+        statsDirectAuto = LatencyStats();
+    } else if (selectedMode == State::AUTO_UE4_APERTURE) {
+        ue4_isWaitingForWhite = true; // Reset sub-state
+        isFirstUe4Run = true;
+        statsBtoW = LatencyStats();   // Clear stats
+        statsWtoB = LatencyStats();
+    } else if (selectedMode == State::DIRECT_UE4_APERTURE) {
+        ue4_isWaitingForWhite = true; // Reset sub-state
+        isFirstUe4Run = true;
+        statsDirectBtoW = LatencyStats(); // Clear stats
+        statsDirectWtoB = LatencyStats();
+    } else if (selectedMode == State::DIRECT_MOTION) {
+        ue4_isWaitingForWhite = true;
+        isFirstUe4Run = true;
+        motionAtStart = true; // The view the session starts from is the reference position
+        statsMotionBtoW = LatencyStats();
+        statsMotionWtoB = LatencyStats();
+    }
+    if (ENABLE_FRAME_PHASE_SCHEDULING) {
+        drawSyncScreen("Detecting refresh...");
+        detectRefreshRate();
+    }
+    if (selectedMode == State::DIRECT_AUTO_MODE || selectedMode == State::DIRECT_UE4_APERTURE ||
+        selectedMode == State::DIRECT_MOTION) {
+        usbMeasurePollPhase();
+    }
+    sdLoggerOpen(selectedMode, maxRuns);
+    runStoreReset();
+    if (ENABLE_SERIAL_TELEMETRY) telemetrySessionStart(selectedMode, maxRuns);
+    runSchedulerReset(); // The first run starts without a delay
+    currentState = selectedMode;
+}
+
+// Closes the session log (unlimited runs end here), clears the mode's stats and returns to the main menu.
+void endMeasurementSession(State modeToClear) {
+    runTimer.end();
+    sdLoggerFinish();
+    baselineReady = false;
+    if (modeToClear == State::AUTO_MODE) {
+        statsAuto = LatencyStats();
+    } else if (modeToClear == State::DIRECT_AUTO_MODE) {
+        statsDirectAuto = LatencyStats();
+    } else if (modeToClear == State::AUTO_UE4_APERTURE) {
+        statsBtoW = LatencyStats(); statsWtoB = LatencyStats(); isFirstUe4Run = true;
+    } else if (modeToClear == State::DIRECT_UE4_APERTURE) {
+        statsDirectBtoW = LatencyStats(); statsDirectWtoB = LatencyStats(); isFirstUe4Run = true;
+    } else if (modeToClear == State::DIRECT_MOTION) {
+        statsMotionBtoW = LatencyStats(); statsMotionWtoB = LatencyStats(); isFirstUe4Run = true;
+    }
+    menuSelection = 0;
+    menuScrollOffset = 0; // Reset scroll
+    currentState = State::SELECT_MENU;
+}
+
+// Inverse of getLogModeCode(). Returns State::SETUP for an unknown code.
+State modeFromLogCode(uint8_t code) {
+    if (code == 1) return State::AUTO_MODE;
+    if (code == 2) return State::DIRECT_AUTO_MODE;
+    if (code == 3) return State::AUTO_UE4_APERTURE;
+    if (code == 4) return State::DIRECT_UE4_APERTURE;
+    if (code == 5) return State::DIRECT_MOTION;
+    return State::SETUP;
+}
+
+// --- Runtime Configuration Storage ---
+// FNV-1a over the settings, detects a half-written or stale EEPROM image.
+uint32_t configChecksum(const RuntimeConfig& config) {
+    const uint8_t* bytes = (const uint8_t*)&config;
+    uint32_t hash = 2166136261UL;
+    for (size_t i = 0; i < sizeof(config); i++) {
+        hash ^= bytes[i];
+        hash *= 16777619UL;
+    }
+    return hash;
+}
+
+// Range check for one parameter, evaluated against the other values in 'config'.
+bool configParamValid(const RuntimeConfig& config, uint8_t param, uint32_t value) {
+    switch (param) {
+        case CFG_LIGHT_THRESHOLD:            return value >= 1 && value <= 255 && (int32_t)value > config.darkThreshold;
+        case CFG_DARK_THRESHOLD:             return value <= 254 && (int32_t)value < config.lightThreshold;
+        case CFG_FLUCTUATION_THRESHOLD:      return value >= 1 && value <= 255;
+        case CFG_CLICK_HOLD_MICROS:          return value >= 1 && value <= 100000;
+        case CFG_AUTO_RUN_DELAY_MS:          return value <= 60000;
+        case CFG_UE4_RUN_DELAY_MS:           return value <= 60000;
+        case CFG_DELAY_JITTER_MS:            return value <= 1000;
+        // The cycle counter wraps after ~7 s, timeouts must stay well below that.
+        case CFG_MEASUREMENT_TIMEOUT_MICROS: return value >= 1000 && value <= 5000000;
+        case CFG_USB_CLICK_PHASE_MODE:       return value <= 2;
+        case CFG_USB_CLICK_PHASE_MICROS:     return value < USB_POLL_INTERVAL_MICROS;
+        default:                             return param < CFG_PARAM_COUNT && value >= 1 && value <= 10000000;
+    }
+}
+
+void configLoad() {
+    StoredConfig stored;
+    EEPROM.get(EEPROM_CONFIG_ADDRESS, stored);
+    if (stored.magic != CONFIG_MAGIC || stored.version != CONFIG_VERSION || stored.size != sizeof(RuntimeConfig) ||
+        stored.checksum != configChecksum(stored.config)) {
+        return; // Nothing saved yet, keep the defaults
+    }
+    if (stored.usbPollRateHz != USB_POLL_RATE_HZ || stored.mousePollRateHz != MOUSE_POLL_RATE_HZ) {
+        // Saved from a build with other polling rates: keep the rest, derive these two for this build.
+        stored.config.clickHoldMicros = MOUSE_CLICK_HOLD_MICROS;
+        stored.config.usbClickPhaseMicros = USB_CLICK_PHASE_MICROS;
+    }
+    const uint32_t* words = (const uint32_t*)&stored.config;
+    for (uint8_t i = 0; i < CFG_PARAM_COUNT; i++) {
+        if (!configParamValid(stored.config, i, words[i])) return;
+    }
+    settings = stored.config;
+}
+
+// Returns false if the EEPROM image doesn't read back correctly.
+bool configSave() {
+    StoredConfig stored;
+    stored.magic = CONFIG_MAGIC;
+    stored.version = CONFIG_VERSION;
+    stored.size = sizeof(RuntimeConfig);
+    stored.usbPollRateHz = USB_POLL_RATE_HZ;
+    stored.mousePollRateHz = MOUSE_POLL_RATE_HZ;
+    stored.config = settings;
+    stored.checksum = configChecksum(settings);
+    EEPROM.put(EEPROM_CONFIG_ADDRESS, stored); // Only changed bytes are written, sparing the flash
+
+    StoredConfig verify;
+    EEPROM.get(EEPROM_CONFIG_ADDRESS, verify);
+    return memcmp(&stored, &verify, sizeof(stored)) == 0;
+}
+
+// --- Host Commands ---
+// Frames from the host are assembled byte by byte from whatever the USB serial port has received,
+// so a poll never waits. loop() calls this between runs only, a command can never land inside a
+// measurement window. Every command is answered with a CommandAck (and a data frame where applicable).
+void commandPoll() {
+    while (Serial.available() > 0) {
+        uint8_t byte = Serial.read();
+        if (commandFill == 0 && byte != FRAME_SYNC) continue; // Hunt for the start of a frame
+        commandBuffer[commandFill++] = byte;
+        if (commandFill < 3) continue;
+
+        uint8_t length = commandBuffer[2];
+        if (length > COMMAND_MAX_PAYLOAD) {
+            commandFill = 0; // Corrupt or foreign frame, resynchronise
+            continue;
+        }
+        if (commandFill < (size_t)length + 4) continue;
+
+        uint8_t sum = 0;
+        for (size_t i = 1; i < commandFill; i++) sum += commandBuffer[i];
+        commandFill = 0;
+        if (sum == 0) {
+            commandHandle(commandBuffer[1], commandBuffer + 3, length);
+        }
+    }
+}
+
+void commandHandle(uint8_t type, const uint8_t* payload, uint8_t length) {
+    // Settings must not change under a running session, the logs record them once per session.
+    bool sessionActive = isMeasurementState(currentState) ||
+                         (currentState == State::HOLD_ACTION && isMeasurementState(previousState));
+
+    switch (type) {
+        case CMD_PING:
+            commandSendAck(type, CommandStatus::OK);
+            break;
+        case CMD_GET_CONFIG:
+            commandSendAck(type, CommandStatus::OK);
+            telemetrySendFrame(FRAME_TYPE_CONFIG, &settings, sizeof(settings));
+            break;
+        case CMD_SET_PARAM: {
+            if (length != 5) { commandSendAck(type, CommandStatus::BAD_LENGTH); break; }
+            if (sessionActive) { commandSendAck(type, CommandStatus::BUSY); break; }
+            uint8_t param = payload[0];
+            uint32_t value;
+            memcpy(&value, payload + 1, sizeof(value));
+            if (!configParamValid(settings, param, value)) { commandSendAck(type, CommandStatus::INVALID_VALUE); break; }
+            ((uint32_t*)&settings)[param] = value;
+            commandSendAck(type, CommandStatus::OK);
+            break;
+        }
+        case CMD_SAVE_CONFIG:
+            commandSendAck(type, configSave() ? CommandStatus::OK : CommandStatus::STORAGE_ERROR);
+            break;
+        case CMD_LOAD_DEFAULTS:
+            if (sessionActive) { commandSendAck(type, CommandStatus::BUSY); break; }
+            settings = RuntimeConfig();
+            commandSendAck(type, CommandStatus::OK);
+            break;
+        case CMD_START: {
+            if (length != 5) { commandSendAck(type, CommandStatus::BAD_LENGTH); break; }
+            State mode = modeFromLogCode(payload[0]);
+            if (mode == State::SETUP) { commandSendAck(type, CommandStatus::INVALID_VALUE); break; }
+            bool idle = currentState == State::SELECT_MENU || currentState == State::SELECT_RUN_LIMIT ||
+                        currentState == State::RUNS_COMPLETE;
+            if (!idle) { commandSendAck(type, CommandStatus::BUSY); break; }
+            bool needsMouse = (mode == State::AUTO_MODE || mode == State::AUTO_UE4_APERTURE);
+            if (needsMouse && !mouseIsOk) { commandSendAck(type, CommandStatus::NOT_READY); break; }
+
+            if (currentState == State::RUNS_COMPLETE) endMeasurementSession(selectedMode);
+            uint32_t runLimit;
+            memcpy(&runLimit, payload + 1, sizeof(runLimit));
+            selectedMode = mode;
+            precisionRunLimit = ENABLE_PRECISION_RUN_LIMIT && runLimit == RUN_LIMIT_PRECISION;
+            maxRuns = precisionRunLimit ? PRECISION_MAX_RUNS : runLimit;
+            beginMeasurementSession();
+            commandSendAck(type, CommandStatus::OK);
+            break;
+        }
+        case CMD_SAVE_BASELINE:
+            if (!ENABLE_BASELINE_COMPARISON || currentState != State::RUNS_COMPLETE || !baselineReady) {
+                commandSendAck(type, CommandStatus::BUSY);
+            } else if (!sdCardPresent) {
+                commandSendAck(type, CommandStatus::NOT_READY);
+            } else {
+                commandSendAck(type, baselineSave(selectedMode) ? CommandStatus::OK : CommandStatus::STORAGE_ERROR);
+            }
+            break;
+        case CMD_STOP:
+            if (isMeasurementState(currentState)) {
+                endMeasurementSession(currentState);
+            } else if (currentState == State::RUNS_COMPLETE) {
+                endMeasurementSession(selectedMode);
+            } else {
+                commandSendAck(type, CommandStatus::BUSY);
+                break;
+            }
+            commandSendAck(type, CommandStatus::OK);
+            break;
+        case CMD_QUERY_STATS:
+            commandSendAck(type, CommandStatus::OK);
+            commandSendStats();
+            break;
+        default:
+            commandSendAck(type, CommandStatus::UNKNOWN_COMMAND);
+            break;
+    }
+}
+
+void commandSendAck(uint8_t command, CommandStatus status) {
+    CommandAck ack;
+    ack.command = command;
+    ack.status = (uint8_t)status;
+    telemetrySendFrame(FRAME_TYPE_ACK, &ack, sizeof(ack));
+}
+
+// Reports the stats of the running mode, or of the mode that just completed.
+void commandSendStats() {
+    State mode = (currentState == State::RUNS_COMPLETE) ? selectedMode : currentState;
+    if (currentState == State::HOLD_ACTION && isMeasurementState(previousState)) mode = previousState;
+
+    LatencyStats* primary = nullptr;
+    LatencyStats* secondary = nullptr;
+    modeStats(mode, primary, secondary);
+
+    StatsReport report;
+    memset(&report, 0, sizeof(report));
+    report.mode = getLogModeCode(mode);
+    report.complete = (currentState == State::RUNS_COMPLETE);
+    StatsSnapshot* snapshots[] = {&report.primary, &report.secondary};
+    const LatencyStats* sources[] = {primary, secondary};
+    for (int i = 0; i < 2; i++) {
+        const LatencyStats* stats = sources[i];
+        if (stats == nullptr || stats->runCount == 0) continue;
+        StatsSnapshot& snap = *snapshots[i];
+        snap.runCount = stats->runCount;
+        snap.lastMs = stats->lastLatency;
+        snap.avgMs = stats->avgLatency;
+        snap.minMs = stats->minLatency;
+        snap.maxMs = stats->maxLatency;
+        snap.stdDevMs = statsStdDev(*stats);
+        snap.p50Ms = statsPercentile(*stats, 0);
+        snap.p90Ms = statsPercentile(*stats, 1);
+        snap.p99Ms = statsPercentile(*stats, 2);
+        snap.usbOffsetMs = stats->avgUsbOffsetMillis;
+    }
+    telemetrySendFrame(FRAME_TYPE_STATS, &report, sizeof(report));
+}
+
+// --- Serial Telemetry ---
+// Runs are encoded into a RAM ring the moment they are measured and drained into the USB serial
+// buffer by telemetryPump() during idle time. availableForWrite() is checked first, so a slow or
+// absent host costs a dropped frame rather than a blocked write.
+bool telemetrySendFrame(uint8_t type, const void* payload, uint8_t length) {
+    size_t frameSize = (size_t)length + 4;
+    size_t used = (telemetryHead + TELEMETRY_BUFFER_SIZE - telemetryTail) % TELEMETRY_BUFFER_SIZE;
+    if (used + frameSize >= TELEMETRY_BUFFER_SIZE) {
+        telemetryDropped++;
+        return false;
+    }
+
+    const uint8_t* bytes = (const uint8_t*)payload;
+    uint8_t sum = type + length;
+    telemetryBuffer[telemetryHead] = FRAME_SYNC;
+    telemetryBuffer[(telemetryHead + 1) % TELEMETRY_BUFFER_SIZE] = type;
+    telemetryBuffer[(telemetryHead + 2) % TELEMETRY_BUFFER_SIZE] = length;
+    for (uint8_t i = 0; i < length; i++) {
+        telemetryBuffer[(telemetryHead + 3 + i) % TELEMETRY_BUFFER_SIZE] = bytes[i];
+        sum += bytes[i];
+    }
+    telemetryBuffer[(telemetryHead + 3 + length) % TELEMETRY_BUFFER_SIZE] = (uint8_t)(0 - sum);
+    telemetryHead = (telemetryHead + frameSize) % TELEMETRY_BUFFER_SIZE;
+    return true;
+}
+
+// Largest frame (header and checksum included) telemetrySendFrame() would accept right now.
+size_t telemetryFree() {
+    size_t used = (telemetryHead + TELEMETRY_BUFFER_SIZE - telemetryTail) % TELEMETRY_BUFFER_SIZE;
+    return TELEMETRY_BUFFER_SIZE - 1 - used;
+}
+
+void telemetrySessionStart(State mode, unsigned long run_limit) {
+    TelemetrySession session;
+    session.cpuHz = F_CPU_ACTUAL;
+    session.runLimit = run_limit;
+    session.mode = getLogModeCode(mode);
+    session.lightThreshold = settings.lightThreshold;
+    session.darkThreshold = settings.darkThreshold;
+    session.reserved = 0;
+    session.sampleIntervalMicros = samplerIntervalMicros;
+    session.refreshHz = refreshHz;
+    session.usbPollRateHz = USB_POLL_RATE_HZ;
+    session.clickHoldMicros = settings.clickHoldMicros;
+    telemetrySendFrame(FRAME_TYPE_SESSION, &session, sizeof(session));
+}
+
+void telemetrySendRun(const LogRecord& record, const RunResult& run) {
+    TelemetryRun frame;
+    frame.runIndex = record.runIndex;
+    frame.mode = record.mode;
+    frame.direction = record.direction;
+    frame.flags = record.flags;
+    frame.latencyCycles = run.latencyCycles;
+    frame.sampleCount = run.sampleCount;
+    frame.syncWaitCycles = run.syncWaitCycles;
+    frame.usbOffsetCycles = run.usbOffsetCycles;
+    frame.timestampMs = record.timestampMs;
+    frame.sensor = record.sensor;
+    frame.framePhase = record.framePhase;
+    memset(frame.reserved, 0, sizeof(frame.reserved));
+    frame.clickIssueCycles = run.clickIssueCycles;
+    frame.clickHoldCycles = run.clickHoldCycles;
+    telemetrySendFrame(FRAME_TYPE_RUN, &frame, sizeof(frame));
+}
+
+// Moves queued bytes into the USB serial buffer without ever blocking.
+// Returns true if anything was sent, so callers can skip other idle work this pass.
+bool telemetryPump() {
+    if (telemetryHead == telemetryTail) return false;
+    if (!Serial) {
+        // No host has the port open, queued runs would only go stale.
+        telemetryTail = telemetryHead;
+        return false;
+    }
+
+    size_t contiguous = (telemetryHead > telemetryTail ? telemetryHead : TELEMETRY_BUFFER_SIZE) - telemetryTail;
+    int space = Serial.availableForWrite();
+    if (space <= 0) return false;
+    size_t count = min(contiguous, (size_t)space);
+    Serial.write(telemetryBuffer + telemetryTail, count);
+    telemetryTail = (telemetryTail + count) % TELEMETRY_BUFFER_SIZE;
+    if (telemetryHead == telemetryTail) Serial.send_now(); // Don't wait for the USB flush timer
+    return true;
+}
+
+// --- PSRAM Run Store ---
+// A fixed arena in external PSRAM holding every run of the session as a LogRecord (integer cycles).
+// Appending is a bounds check and a 32-byte copy, so the measurement path never allocates. The arena
+// is only touched when the startup code detected a chip large enough to hold it.
+void runStoreBegin() {
+    size_t required = sizeof(runStore) + sizeof(runStoreScratch);
+    size_t available = (size_t)external_psram_size * 1024 * 1024;
+    runStoreCapacity = (ENABLE_PSRAM_RUN_STORE && available >= required) ? PSRAM_RUN_STORE_CAPACITY : 0;
+    runStoreReset();
+}
+
+void runStoreReset() {
+    runStoreCount = 0;
+    runStoreDropped = 0;
+}
+
+void runStoreAppend(const LogRecord& record) {
+    if (runStoreCapacity == 0) return;
+    if (runStoreCount < runStoreCapacity) {
+        runStore[runStoreCount++] = record;
+    } else {
+        runStoreDropped++;
+    }
+}
+
+// Replaces the streaming percentile estimates of 'stats' with exact nearest-rank values computed from
+// the stored runs of one direction. Skipped if runs were dropped, the estimates then cover more data.
+void runStoreFinalize(LatencyStats& stats, Transition direction) {
+    if (runStoreCapacity == 0 || runStoreDropped > 0) return;
+
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < runStoreCount; i++) {
+        if (runStore[i].direction == (uint8_t)direction && runStore[i].sensor == 0) {
+            runStoreScratch[count++] = runStore[i].latencyCycles;
+        }
+    }
+    if (count == 0) return;
+
+    std::sort(runStoreScratch, runStoreScratch + count);
+    const float quantiles[3] = {0.50f, 0.90f, 0.99f};
+    for (int i = 0; i < 3; i++) {
+        int rank = (int)ceil(quantiles[i] * count) - 1;
+        uint32_t cycles = runStoreScratch[constrain(rank, 0, (int)count - 1)];
+        stats.exactPercentile[i] = cyclesToMicros(cycles) / 1000.0f;
+    }
+    stats.percentilesExact = true;
+}
+
+// Runs once when a limited session completes, for the stats of the mode that just finished.
+void finalizeSessionStats() {
+    if (selectedMode == State::AUTO_MODE) {
+        runStoreFinalize(statsAuto, Transition::DARK_TO_LIGHT);
+    } else if (selectedMode == State::DIRECT_AUTO_MODE) {
+        runStoreFinalize(statsDirectAuto, Transition::DARK_TO_LIGHT);
+    } else if (selectedMode == State::AUTO_UE4_APERTURE) {
+        runStoreFinalize(statsBtoW, Transition::DARK_TO_LIGHT);
+        runStoreFinalize(statsWtoB, Transition::LIGHT_TO_DARK);
+    } else if (selectedMode == State::DIRECT_UE4_APERTURE) {
+        runStoreFinalize(statsDirectBtoW, Transition::DARK_TO_LIGHT);
+        runStoreFinalize(statsDirectWtoB, Transition::LIGHT_TO_DARK);
+    } else if (selectedMode == State::DIRECT_MOTION) {
+        runStoreFinalize(statsMotionBtoW, Transition::DARK_TO_LIGHT);
+        runStoreFinalize(statsMotionWtoB, Transition::LIGHT_TO_DARK);
+    }
+}
+
+// --- Baseline Comparison ---
+// Each mode keeps at most one baseline on the card (BASELINE_FILE_PREFIX + mode). A completed session is
+// compared against it once, right after its log is closed; the CMP page then only draws the result.
+
+// Log-spaced histogram bin of a latency, each bin is the same ratio wide.
+int latencyHistogramBin(float latencyMillis) {
+    static const float scale = BASELINE_HISTOGRAM_BINS / logf(BASELINE_HISTOGRAM_MAX_MS / BASELINE_HISTOGRAM_MIN_MS);
+    if (latencyMillis <= BASELINE_HISTOGRAM_MIN_MS) return 0;
+    return min((int)(logf(latencyMillis / BASELINE_HISTOGRAM_MIN_MS) * scale), BASELINE_HISTOGRAM_BINS - 1);
+}
+
+// The stats a mode's runs go to. 'second' is the W-to-B side of the toggling modes, nullptr for the
+// Auto modes. Returns false (both nullptr) for a state that isn't a measurement mode.
+bool modeStats(State mode, LatencyStats*& first, LatencyStats*& second) {
+    first = nullptr;
+    second = nullptr;
+    if (mode == State::AUTO_MODE) first = &statsAuto;
+    else if (mode == State::DIRECT_AUTO_MODE) first = &statsDirectAuto;
+    else if (mode == State::AUTO_UE4_APERTURE) { first = &statsBtoW; second = &statsWtoB; }
+    else if (mode == State::DIRECT_UE4_APERTURE) { first = &statsDirectBtoW; second = &statsDirectWtoB; }
+    else if (mode == State::DIRECT_MOTION) { first = &statsMotionBtoW; second = &statsMotionWtoB; }
+    return first != nullptr;
+}
+
+String baselinePath(State mode) {
+    return String(SD_LOG_DIRECTORY) + "/" + BASELINE_FILE_PREFIX + getModeString(mode) + ".bsl";
+}
+
+// Reads the baseline of 'mode' into 'baseline'. False if there is none or it was made with other histogram bins.
+bool baselineLoad(State mode) {
+    FsFile file = SD.sdfs.open(baselinePath(mode).c_str(), O_RDONLY);
+    if (!file) return false;
+    bool ok = file.read(&baseline, sizeof(baseline)) == (int)sizeof(baseline);
+    file.close();
+    return ok && memcmp(baseline.magic, BASELINE_MAGIC, sizeof(baseline.magic)) == 0 &&
+           baseline.version == BASELINE_FORMAT_VERSION && baseline.mode == getLogModeCode(mode) &&
+           baseline.bins == BASELINE_HISTOGRAM_BINS && baseline.histogramMinMs == BASELINE_HISTOGRAM_MIN_MS &&
+           baseline.histogramMaxMs == BASELINE_HISTOGRAM_MAX_MS;
+}
+
+// Stores the completed session of 'mode' as its baseline (replacing the previous one) and compares
+// against it from now on.
+bool baselineSave(State mode) {
+    LatencyStats* directions[2];
+    if (!modeStats(mode, directions[0], directions[1])) return false;
+
+    memset(&baseline, 0, sizeof(baseline));
+    memcpy(baseline.magic, BASELINE_MAGIC, sizeof(baseline.magic));
+    baseline.version = BASELINE_FORMAT_VERSION;
+    baseline.mode = getLogModeCode(mode);
+    baseline.directions = directions[1] ? 2 : 1;
+    baseline.bins = BASELINE_HISTOGRAM_BINS;
+    baseline.histogramMinMs = BASELINE_HISTOGRAM_MIN_MS;
+    baseline.histogramMaxMs = BASELINE_HISTOGRAM_MAX_MS;
+    // Named after the session's log without directory and extension, the mode when nothing was logged
+    const char* logName = strrchr(logFilePath.c_str(), '/');
+    if (logName) {
+        const char* extension = strrchr(logName, '.');
+        snprintf(baseline.name, sizeof(baseline.name), "%.*s", (int)(extension ? extension - logName - 1 : strlen(logName + 1)), logName + 1);
+    } else {
+        snprintf(baseline.name, sizeof(baseline.name), "%s", getModeString(mode).c_str());
+    }
+    for (int i = 0; i < baseline.directions; i++) {
+        const LatencyStats& stats = *directions[i];
+        BaselineSummary& summary = baseline.summary[i];
+        summary.runCount = stats.runCount;
+        summary.meanMs = stats.avgLatency;
+        summary.p50Ms = statsPercentile(stats, 0);
+        summary.p99Ms = statsPercentile(stats, 2);
+        memcpy(summary.histogram, stats.histogram, sizeof(summary.histogram));
+    }
+
+    FsFile file = SD.sdfs.open(baselinePath(mode).c_str(), O_RDWR | O_CREAT | O_TRUNC);
+    bool ok = file && file.write(&baseline, sizeof(baseline)) == sizeof(baseline);
+    file.close();
+    baselineLoaded = ok;
+    baselineIsSession = ok;
+    baselineCompareSession();
+    return ok;
+}
+
+// Change in mean and p99 against the baseline, and a two-sided Mann-Whitney U test on the histograms.
+// Runs in the same bin count as ties; the normal approximation with tie correction is accurate for the
+// run counts a session has.
+void baselineCompare(const LatencyStats& current, const BaselineSummary& reference, BaselineComparison& out) {
+    out = BaselineComparison();
+    if (current.runCount == 0 || reference.runCount == 0) return;
+    out.valid = true;
+    out.deltaMeanMs = current.avgLatency - reference.meanMs;
+    out.deltaP99Ms = statsPercentile(current, 2) - reference.p99Ms;
+
+    // U counts the (session, baseline) pairs in which the session run was slower, ties count half.
+    double u = 0.0, below = 0.0, n = 0.0, m = 0.0, ties = 0.0;
+    for (int i = 0; i < BASELINE_HISTOGRAM_BINS; i++) {
+        double a = current.histogram[i];
+        double b = reference.histogram[i];
+        u += a * (below + b / 2.0);
+        below += b;
+        n += a;
+        m += b;
+        double t = a + b;
+        ties += t * t * t - t;
+    }
+    double total = n + m;
+    double variance = n * m / 12.0 * ((total + 1.0) - ties / (total * (total - 1.0)));
+    if (variance <= 0.0) return; // Everything in one bin, no evidence either way
+    double z = (u - n * m / 2.0) / sqrt(variance);
+    out.pValue = (float)erfc(fabs(z) / M_SQRT2);
+    if (out.pValue < BASELINE_SIGNIFICANCE) out.verdict = (z > 0.0) ? 1 : -1;
+}
+
+void baselineCompareSession() {
+    baselineComparison[0] = BaselineComparison();
+    baselineComparison[1] = BaselineComparison();
+    LatencyStats* directions[2];
+    if (!baselineLoaded || !modeStats(selectedMode, directions[0], directions[1])) return;
+    for (int i = 0; i < 2 && directions[i] && i < baseline.directions; i++) {
+        baselineCompare(*directions[i], baseline.summary[i], baselineComparison[i]);
+    }
+}
+
+// Runs once when a limited session completes, after finalizeSessionStats() (p99 is exact by then).
+void baselineSessionComplete() {
+    baselineLoaded = false;
+    baselineIsSession = false;
+    baselineReady = ENABLE_BASELINE_COMPARISON && sdCardPresent;
+    if (!baselineReady) return;
+    baselineLoaded = baselineLoad(selectedMode);
+    if (!baselineLoaded && BASELINE_AUTO_SAVE) {
+        baselineSave(selectedMode); // The first session of a mode becomes its reference
+        return;
+    }
+    baselineCompareSession();
+}
+
+// True while the CMP page of a completed session is shown, which turns the SELECT hold into "save as baseline".
+bool baselineSaveOffered(State heldFrom) {
+    if (!ENABLE_BASELINE_COMPARISON || heldFrom != State::RUNS_COMPLETE || !baselineReady) return false;
+    StatsPage pages[MAX_STATS_PAGES];
+    return pages[min(statsPage, statsPageList(selectedMode, pages) - 1)] == StatsPage::BASE;
+}
+
+// --- Waveform Capture ---
+// In the UE4 modes the detector stops at the first sample past the threshold, while the rest of the panel's
+// response is still in the sample ring and arriving. The capture picks up from the ring right after the
+// crossing, so the trace starts up to WAVEFORM_PRE_TRIGGER_MICROS before it, and keeps reading the stream
+// for the post-trigger window. Sending happens between runs, one frame or SD chunk per idle slot.
+void waveformBegin() {
+    size_t required = sizeof(runStore) + sizeof(runStoreScratch) + sizeof(waveformPoints);
+    size_t available = (size_t)external_psram_size * 1024 * 1024;
+    waveformAvailable = ENABLE_WAVEFORM_CAPTURE && available >= required;
+    waveformReset();
+}
+
+void waveformReset() {
+    waveformStats[0] = WaveformStats();
+    waveformStats[1] = WaveformStats();
+    waveformRejected = 0;
+    waveformSkipped = 0;
+    waveformPendingSerial = false;
+    waveformPendingSd = false;
+}
 
-    // Store raw value for logging if enabled
-    if (ENABLE_SD_LOGGING && sdCardPresent) {
-        latencies.push_back(latencyMillis);
+// Records the trace around the crossing at 'edgeIndex' into waveformPoints. Must be called right after
+// the detector returned, before the ring overwrites the pre-trigger samples. Blocks for the post-trigger
+// window. Returns false if samples were lost or the trace can't be measured.
+bool waveformCapture(uint32_t edgeIndex, WaveformHeader& header) {
+    const uint32_t samplesPerPoint = max(1L, lroundf(WAVEFORM_POINT_MICROS / samplerIntervalMicros));
+    const float pointMicros = samplesPerPoint * samplerIntervalMicros;
+    // The ring only reaches back so far; half of it stays free for the samples arriving meanwhile.
+    const uint32_t preSamples = min((uint32_t)(WAVEFORM_PRE_TRIGGER_MICROS / samplerIntervalMicros), SAMPLER_SPAN / 2);
+    const uint32_t prePoints = min(preSamples / samplesPerPoint, (uint32_t)UINT16_MAX);
+    const uint32_t pointCount = min(WAVEFORM_MAX_POINTS, prePoints + (uint32_t)(WAVEFORM_POST_TRIGGER_MICROS / pointMicros));
+    if (prePoints < 4 || pointCount < prePoints + 16) return false;
+
+    // Rewind the consumer to the start of the pre-trigger window.
+    samplerCursor = edgeIndex - prePoints * samplesPerPoint;
+    if (samplerRefresh() - samplerCursor > SAMPLER_SPAN - 16) return false;
+    samplerOverrun = false;
+
+    const unsigned long timeoutMicros = 2 * (WAVEFORM_PRE_TRIGGER_MICROS + WAVEFORM_POST_TRIGGER_MICROS);
+    elapsedMicros captureTimer;
+    uint32_t pointSum = 0, pointFill = 0, count = 0;
+    uint8_t value;
+    while (count < pointCount) {
+        if (!samplerNext(value)) {
+            if (captureTimer > timeoutMicros) return false; // Sampler stalled
+            continue;
+        }
+        pointSum += value;
+        if (++pointFill == samplesPerPoint) {
+            waveformPoints[count++] = (uint16_t)(pointSum * 256 / samplesPerPoint);
+            pointSum = 0;
+            pointFill = 0;
+        }
     }
+    if (samplerOverrun) return false;
 
-    // Update the provided stats struct
-    stats.runCount++;
-    stats.lastLatency = latencyMillis;
-    // Use a numerically stable rolling average formula
-    stats.avgLatency = stats.avgLatency + (latencyMillis - stats.avgLatency) / stats.runCount;
-    if (latencyMillis < stats.minLatency) stats.minLatency = latencyMillis;
-    if (latencyMillis > stats.maxLatency) stats.maxLatency = latencyMillis;
+    header.triggerPoint = prePoints;
+    header.pointCount = pointCount;
+    header.pointMicros = pointMicros;
+    return waveformMeasure(header);
 }
 
-// --- Helper function to align text on the display ---
-void alignText(const char* text, int y, TextAlign align) {
-    int targetY;
+// First point position (fractional, interpolated) at or after 'from' where the normalized trace reaches
+// 'level', or -1 if it never does.
+static float waveformCrossing(const WaveformHeader& header, float start, float swing, float level, uint32_t from) {
+    float previous = ((float)waveformPoints[from] - start) / swing;
+    if (previous >= level) return from;
+    for (uint32_t i = from + 1; i < header.pointCount; i++) {
+        float progress = ((float)waveformPoints[i] - start) / swing;
+        if (progress >= level) return (i - 1) + (level - previous) / (progress - previous);
+        previous = progress;
+    }
+    return -1.0f;
+}
 
-    // Check if a Y coordinate was provided. If not, use the current one.
-    if (y == -1) {
-        targetY = display.getCursorY();
-    } else {
-        targetY = y;
+// Fills in the levels and response metrics of the trace in waveformPoints. The trace is normalized to
+// 0 at the start level and 1 at the final level, so rises and falls are measured the same way.
+bool waveformMeasure(WaveformHeader& header) {
+    const uint32_t count = header.pointCount;
+    // Start level: the first half of the pre-trigger window. Final level: the last tenth of the trace.
+    const uint32_t startPoints = max(1u, (uint32_t)header.triggerPoint / 2);
+    const uint32_t endPoints = max(1u, count / 10);
+    float start = 0.0f, end = 0.0f;
+    for (uint32_t i = 0; i < startPoints; i++) start += waveformPoints[i];
+    for (uint32_t i = count - endPoints; i < count; i++) end += waveformPoints[i];
+    start /= startPoints;
+    end /= endPoints;
+    header.startLevel = start / 256.0f;
+    header.endLevel = end / 256.0f;
+    const float swing = end - start;
+    if (fabsf(swing) < WAVEFORM_MIN_SWING * 256.0f) return false;
+
+    float t10 = waveformCrossing(header, start, swing, 0.1f, 0);
+    if (t10 < 0) return false;
+    float t90 = waveformCrossing(header, start, swing, 0.9f, (uint32_t)t10);
+    if (t90 < 0) return false;
+
+    // Overshoot and settling are only looked for once the transition is under way.
+    float peak = 0.0f;
+    uint32_t lastOutside = (uint32_t)t10;
+    for (uint32_t i = (uint32_t)t10; i < count; i++) {
+        float progress = ((float)waveformPoints[i] - start) / swing;
+        peak = max(peak, progress);
+        if (fabsf(progress - 1.0f) > WAVEFORM_SETTLE_BAND) lastOutside = i;
     }
+    header.riseMicros = (t90 - t10) * header.pointMicros;
+    header.settleMicros = (lastOutside + 1 - t10) * header.pointMicros;
+    header.overshootPercent = max(0.0f, peak - 1.0f) * 100.0f;
+    return true;
+}
 
-    int16_t x1, y1;
-    uint16_t w, h;
-    display.getTextBounds(text, 0, 0, &x1, &y1, &w, &h);
+// Captures and measures the transition that 'run' just detected and queues the trace for sending.
+// 'runIndex' is the number the run gets in its direction's stats.
+void waveformAfterRun(const RunResult& run, Transition direction, unsigned long runIndex) {
+    if (!waveformAvailable) return;
+    if (waveformPendingSerial || waveformPendingSd) {
+        waveformSkipped++;
+        return;
+    }
 
-    int x = 0;
-    switch(align) {
-        case TextAlign::LEFT:
-            x = 0;
-            break;
-        case TextAlign::CENTER:
-            x = (SCREEN_WIDTH - w) / 2;
-            break;
-        case TextAlign::RIGHT:
-            x = SCREEN_WIDTH - w - 4;
-            break;
+    WaveformHeader header;
+    memset(&header, 0, sizeof(header));
+    if (!waveformCapture(run.edgeIndex, header)) {
+        waveformRejected++;
+        return;
     }
+    header.runIndex = runIndex;
+    header.mode = getLogModeCode(currentState);
+    header.direction = (uint8_t)direction;
+
+    WaveformStats& stats = waveformStats[(int)direction];
+    stats.count++;
+    stats.avgRiseMicros += (header.riseMicros - stats.avgRiseMicros) / stats.count;
+    stats.avgSettleMicros += (header.settleMicros - stats.avgSettleMicros) / stats.count;
+    stats.avgOvershootPercent += (header.overshootPercent - stats.avgOvershootPercent) / stats.count;
+    stats.maxOvershootPercent = fmaxf(stats.maxOvershootPercent, header.overshootPercent);
+
+    waveformPending = header;
+    waveformSerialSent = 0;
+    waveformSdWritten = -1;
+    waveformPendingSerial = ENABLE_SERIAL_TELEMETRY && WAVEFORM_STREAM_SERIAL && Serial &&
+                            telemetrySendFrame(FRAME_TYPE_WAVEFORM, &header, sizeof(header));
+    waveformPendingSd = (bool)waveformFile;
+}
 
-    display.setCursor(max(0, x), targetY); // Use max(0, x) to prevent negative coordinates
-    display.println(text);
+// Opens the session's .wfm file next to its binary log (same name, .wfm extension).
+void waveformOpenFile(const String& logPath) {
+    if (!waveformAvailable || !WAVEFORM_LOG_SD) return;
+    String path = logPath.substring(0, logPath.length() - 4) + ".wfm";
+    waveformFile = SD.sdfs.open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC);
+    if (!waveformFile) return;
+
+    WaveformFileHeader fileHeader;
+    memcpy(fileHeader.magic, WAVEFORM_MAGIC, sizeof(fileHeader.magic));
+    fileHeader.version = WAVEFORM_FORMAT_VERSION;
+    fileHeader.traceHeaderSize = sizeof(WaveformHeader);
+    fileHeader.sampleIntervalMicros = samplerIntervalMicros;
+    waveformFile.write(&fileHeader, sizeof(fileHeader));
 }
 
-// --- Helper function to manage menu scrolling ---
-void updateScrollOffset(int selection, int& scrollOffset, int optionCount, int maxVisibleItems) {
-    // If selection moves above the visible window, adjust the window up.
-    if (selection < scrollOffset) {
-        scrollOffset = selection;
-    }
-    // If selection moves below the visible window, adjust the window down.
-    else if (selection >= scrollOffset + maxVisibleItems) {
-        scrollOffset = selection - maxVisibleItems + 1;
+// Queues the next frame of the pending trace if the telemetry buffer has room for it, so points are
+// never dropped halfway through a trace. Returns true if a frame was queued.
+bool waveformPumpSerial() {
+    if (!waveformPendingSerial) return false;
+    if (!Serial) {
+        waveformPendingSerial = false;
+        return false;
     }
+    WaveformChunk chunk;
+    uint32_t remaining = waveformPending.pointCount - waveformSerialSent;
+    chunk.count = min(remaining, (uint32_t)WAVEFORM_CHUNK_POINTS);
+    size_t length = offsetof(WaveformChunk, points) + chunk.count * sizeof(uint16_t);
+    if (telemetryFree() < length + 4) return false;
+
+    chunk.runIndex = waveformPending.runIndex;
+    chunk.direction = waveformPending.direction;
+    chunk.reserved = 0;
+    chunk.firstPoint = waveformSerialSent;
+    memcpy(chunk.points, waveformPoints + waveformSerialSent, chunk.count * sizeof(uint16_t));
+    telemetrySendFrame(FRAME_TYPE_WAVEFORM_DATA, &chunk, length);
+    waveformSerialSent += chunk.count;
+    if (waveformSerialSent == waveformPending.pointCount) waveformPendingSerial = false;
+    return true;
+}
 
-    // This logic is mostly for safety, ensuring scrollOffset doesn't go out of bounds
-    // if the option count is smaller than the displayable item count.
-    if (optionCount <= maxVisibleItems) {
-        scrollOffset = 0;
-    } else if (scrollOffset > optionCount - maxVisibleItems) {
-        scrollOffset = optionCount - maxVisibleItems;
+// Writes the pending trace's header, or its next sector's worth of points, to the .wfm file.
+bool waveformPumpSd() {
+    if (!waveformPendingSd) return false;
+    if (waveformSdWritten < 0) {
+        waveformFile.write(&waveformPending, sizeof(waveformPending));
+        waveformSdWritten = 0;
+        return true;
     }
+    const uint32_t sectorPoints = LOG_SECTOR_SIZE / sizeof(uint16_t);
+    uint32_t count = min(waveformPending.pointCount - (uint32_t)waveformSdWritten, sectorPoints);
+    waveformFile.write(waveformPoints + waveformSdWritten, count * sizeof(uint16_t));
+    waveformSdWritten += count;
+    if ((uint32_t)waveformSdWritten == waveformPending.pointCount) waveformPendingSd = false;
+    return true;
 }
 
+bool waveformPump() {
+    bool sent = waveformPumpSerial();
+    return waveformPumpSd() || sent;
+}
 
-// --- Display Functions ---
-
-// Displays a formatted, full-screen error message and then pauses.
-void displayErrorScreen(const char* title, const char* line1, const char* line2, const char* line3, unsigned long delayMs) {
-    display.clearDisplay();
-    display.setTextSize(1);
-    display.setTextColor(SSD1306_WHITE);
-    alignText(title, 0);
-    display.drawLine(0, 8, SCREEN_WIDTH - 1, 8, SSD1306_WHITE);
-    if (line1) alignText(line1, 20);
-    if (line2) alignText(line2, 32);
-    if (line3) alignText(line3, 48);
-    display.display();
-    delay(delayMs);
+// --- Display Renderer ---
+// Replaces the full 1 KB display() push with page-level diffing. A shadow copy holds what the
+// panel currently shows; only pages whose framebuffer bytes differ are sent. Pages can be flushed
+// all at once (menus, sync screens) or one per call via rendererPump() during inter-run delays.
+// Teensy 4 Wire has no non-blocking master API, so transfers are time-sliced per page instead.
+// Every draw path must end in rendererFlush() (not display.display()) to keep the shadow in sync.
+
+// Compares the framebuffer against the shadow copy and flags the pages that changed.
+void rendererMarkDirty() {
+    const uint8_t* frame = display.getBuffer();
+    for (int page = 0; page < DISPLAY_PAGE_COUNT; ++page) {
+        if (memcmp(frame + page * SCREEN_WIDTH, displayShadow + page * SCREEN_WIDTH, SCREEN_WIDTH) != 0) {
+            displayDirtyPages |= (1 << page);
+        }
+    }
 }
 
-void updateDisplay() {
-    // Do not update the display from here if we are in setup mode, as it has its own display logic
-    if (currentState == State::SETUP) return;
+// Pushes one page of the framebuffer to the panel. The page stays dirty if the transfer fails.
+bool rendererSendPage(int page) {
+    static_assert(SCREEN_WIDTH + 1 <= BUFFER_LENGTH, "One display page must fit in a single Wire transfer");
+    const uint8_t* pageData = display.getBuffer() + page * SCREEN_WIDTH;
+
+    // Set the RAM window to this page only (horizontal addressing mode is configured by begin()).
+    Wire.beginTransmission(SCREEN_ADDRESS);
+    Wire.write((uint8_t)0x00); // Control byte: command stream
+    Wire.write((uint8_t)SSD1306_PAGEADDR);
+    Wire.write((uint8_t)page);
+    Wire.write((uint8_t)page);
+    Wire.write((uint8_t)SSD1306_COLUMNADDR);
+    Wire.write((uint8_t)0);
+    Wire.write((uint8_t)(SCREEN_WIDTH - 1));
+    bool sent = Wire.endTransmission() == 0;
+
+    if (sent) {
+        Wire.beginTransmission(SCREEN_ADDRESS);
+        Wire.write((uint8_t)0x40); // Control byte: data stream
+        Wire.write(pageData, SCREEN_WIDTH);
+        sent = Wire.endTransmission() == 0;
+    }
+    if (!sent) {
+        if (displayPageFailures < DISPLAY_PAGE_MAX_FAILURES) displayPageFailures++;
+        if (displayPageFailures >= DISPLAY_PAGE_MAX_FAILURES) {
+            if (!displayFault) digitalWrite(PIN_LED_BUILTIN, HIGH);
+            displayFault = true;
+            displayFaultTimer = 0;
+        }
+        return false;
+    }
+    if (displayFault) digitalWrite(PIN_LED_BUILTIN, LOW);
+    displayFault = false;
+    displayPageFailures = 0;
 
-    display.clearDisplay();
-    display.setTextSize(1);
-    display.setTextColor(SSD1306_WHITE);
+    memcpy(displayShadow + page * SCREEN_WIDTH, pageData, SCREEN_WIDTH);
+    displayDirtyPages &= ~(1 << page);
+    return true;
+}
 
-    switch (currentState) {
-        case State::SELECT_MENU:
-            drawMenuScreen();
-            break;
-        case State::SELECT_RUN_LIMIT:
-            drawRunLimitMenuScreen();
-            break;
-        case State::SELECT_DEBUG_MENU:
-            drawDebugMenuScreen();
-            break;
-        case State::HOLD_ACTION:
-            drawHoldActionScreen();
-            break;
-        case State::AUTO_MODE:
-        case State::DIRECT_AUTO_MODE:
-        case State::AUTO_UE4_APERTURE:
-        case State::DIRECT_UE4_APERTURE:
-        case State::RUNS_COMPLETE:
-            drawOperationScreen();
-            break;
-        case State::DEBUG_MOUSE:
-            drawMouseDebugScreen();
-            break;
-        case State::DEBUG_LSENSOR:
-            drawLightSensorDebugScreen();
-            break;
-        default:
-            // Do not clear display in error state from here
-            break;
+// Sends the lowest dirty page, if any. Returns true if a transfer was made. While the panel doesn't
+// answer, only one retry per DISPLAY_FAULT_BACKOFF_MS is made.
+bool rendererPump() {
+    if (displayDirtyPages == 0) return false;
+    if (displayFault && displayFaultTimer < DISPLAY_FAULT_BACKOFF_MS) return false;
+    rendererSendPage(__builtin_ctz(displayDirtyPages));
+    return true;
+}
+
+// Synchronous replacement for display.display(): sends every page that changed.
+void rendererFlush() {
+    rendererMarkDirty();
+    for (int page = 0; page < DISPLAY_PAGE_COUNT; ++page) {
+        if (displayDirtyPages & (1 << page)) rendererSendPage(page);
     }
-    display.display();
 }
 
 // --- Icon Bitmaps ---
@@ -1293,11 +4541,16 @@ void drawSetupScreen(bool monitorOk, bool sensorOk, bool mouseOk, bool sdOk) {
     
     // if (monitorOk && sensorOk && mouseOk) { Removed cus redundant.
     display.drawLine(0, 35, SCREEN_WIDTH - 1, 35, SSD1306_WHITE);
-    alignText("Hold Button to Start", 42);
+
+    // The polling rate is fixed at build time (PlatformIO environment), show which one this is.
+    char rateBuf[24];
+    sprintf(rateBuf, "USB Poll: %d Hz", USB_POLL_RATE_HZ);
+    alignText(rateBuf, 38);
+    alignText("Hold Button to Start", 47);
 
     // Footer
     alignText(GITHUB_TAG, 56);
-    display.display();
+    rendererFlush();
 }
 
 // Hold Action Screen with Progress Bars
@@ -1317,11 +4570,13 @@ void drawHoldActionScreen() {
     // --- SELECT / EXIT / BYPASS Bar ---
     display.setCursor(0, 18);
     bool isSelectValid = (previousState == State::SELECT_MENU || previousState == State::SELECT_RUN_LIMIT || previousState == State::SELECT_DEBUG_MENU || currentState == State::SETUP);
-    bool isExitClearValid = (previousState == State::AUTO_MODE || previousState == State::DIRECT_AUTO_MODE || previousState == State::AUTO_UE4_APERTURE || previousState == State::DIRECT_UE4_APERTURE || previousState == State::RUNS_COMPLETE);
+    bool isExitClearValid = (previousState == State::AUTO_MODE || previousState == State::DIRECT_AUTO_MODE || previousState == State::AUTO_UE4_APERTURE || previousState == State::DIRECT_UE4_APERTURE || previousState == State::DIRECT_MOTION || previousState == State::RUNS_COMPLETE);
     bool isBypassValid = (previousState == State::DEBUG_MOUSE);
 
     if (isBypassValid) {
         display.print("BYPASS");
+    } else if (baselineSaveOffered(previousState)) {
+        display.print("SAVE");
     } else if (isSelectValid) {
         display.print("SELECT");
     } else if (isExitClearValid) {
@@ -1397,32 +4652,157 @@ void drawLightSensorDebugScreen() {
     display.drawLine(0, 8, SCREEN_WIDTH-1, 8, SSD1306_WHITE);
 
     // Live Data
-    int rawValue = fastAnalogRead(PIN_LIGHT_SENSOR);
+    int rawValue = samplerLatest();
+    char intervalStr[10];
+    dtostrf(samplerIntervalMicros, 5, 3, intervalStr); // Format interval to "X.XXX"
 
     display.setCursor(0, 16);
     display.print("Pin: ");
     display.print(PIN_LIGHT_SENSOR);
+    // Edge filter in use, e.g. "AVG5" (see EDGE_FILTER_MODE)
+    const char* filterNames[] = {"RAW", "N/M", "AVG", "MED"};
+    display.print("  Filt: ");
+    if (EDGE_FILTER_MODE == 1) {
+        display.print(EDGE_FILTER_CONFIRM); display.print("/"); display.print(EDGE_FILTER_WINDOW);
+    } else {
+        display.print(filterNames[EDGE_FILTER_MODE]);
+        if (EDGE_FILTER_MODE != 0) display.print(EDGE_FILTER_WINDOW);
+    }
 
-    display.setCursor(0, 28);
+    display.setCursor(0, 26);
     display.print("Live Reading: ");
     display.print(rawValue);
-    display.setCursor(0, 40);
+    display.setCursor(0, 36);
+    display.print("Sample: ");
+    display.print(intervalStr);
+    display.print("us");
+    display.setCursor(0, 46);
     display.print("Fails if Fluct >");
-    display.print(SENSOR_FLUCTUATION_THRESHOLD);
+    display.print(settings.fluctuationThreshold);
 
     // Footer
     alignText(GITHUB_TAG, 56);
 }
 
+void drawCalibrationScreen() {
+    alignText("CALIBRATION", 0);
+    display.drawLine(0, 8, SCREEN_WIDTH - 1, 8, SSD1306_WHITE);
+    if (!calibrationDone) return;
+
+    char line[24];
+    if (calibrationOk) {
+        snprintf(line, sizeof(line), "Floor %d Peak %d", (int)lroundf(calibrationFloor), (int)lroundf(calibrationPeak));
+        alignText(line, 14);
+        char noiseStr[8];
+        dtostrf(calibrationNoise, 4, 1, noiseStr);
+        snprintf(line, sizeof(line), "Noise %s", noiseStr);
+        alignText(line, 23);
+        snprintf(line, sizeof(line), "Dark %d Light %d", (int)settings.darkThreshold, (int)settings.lightThreshold);
+        alignText(line, 32);
+    } else {
+        alignText("FAILED", 20);
+    }
+    alignText(calibrationMessage, 41);
+    alignText("Click button to exit.", 56);
+}
+
+// Microseconds below 1 ms, milliseconds above, 7 characters either way.
+void formatBenchmarkValue(float micros, char* out, size_t size) {
+    char number[8];
+    if (micros < 1000.0f) {
+        dtostrf(micros, 5, micros < 10.0f ? 2 : 1, number);
+        snprintf(out, size, "%sus", number);
+    } else {
+        dtostrf(micros / 1000.0f, 5, 2, number);
+        snprintf(out, size, "%sms", number);
+    }
+}
+
+// One row per primitive: mean and p99. There is no room for a footer, a click exits.
+void drawBenchmarkScreen() {
+    alignText("BENCHMARK", 0, TextAlign::LEFT);
+    alignText("avg    p99", 0, TextAlign::RIGHT);
+    display.drawLine(0, 8, SCREEN_WIDTH - 1, 8, SSD1306_WHITE);
+    if (!benchmarkDone) return;
+
+    for (int i = 0; i < BENCH_COUNT; ++i) {
+        const BenchmarkResult& result = benchmarkResults[i];
+        char line[24];
+        if (result.count == 0) {
+            snprintf(line, sizeof(line), "%-6s      n/a", benchmarkNames[i]);
+        } else {
+            char mean[12], p99[12];
+            formatBenchmarkValue(result.meanMicros, mean, sizeof(mean));
+            formatBenchmarkValue(p2Value(result.p99), p99, sizeof(p99));
+            snprintf(line, sizeof(line), "%-6s%s %s", benchmarkNames[i], mean, p99);
+        }
+        alignText(line, 10 + i * 9, TextAlign::LEFT);
+    }
+}
+
 void drawPollingTestScreen() {
     alignText("POLLING TEST", 0);
     display.drawLine(0, 8, SCREEN_WIDTH - 1, 8, SSD1306_WHITE);
 
-    alignText("Mouse moving...", 20);
-    alignText("Use HamsterWheel", 32);
-    alignText("Click button to exit.", 44);
+    if (!polltestHasResult) {
+        alignText("Mouse moving...", 20);
+        alignText("Measuring rate...", 32);
+        alignText("Click button to exit.", 44);
+        alignText(GITHUB_TAG, 56);
+        return;
+    }
+
+    // Rates per second, whatever the window length.
+    float scale = 1000.0f / POLLING_TEST_WINDOW_MS;
+    char line[24];
+    sprintf(line, "Rate: %lu/%d Hz", (unsigned long)lroundf(polltestResult.reports * scale), USB_POLL_RATE_HZ);
+    alignText(line, 14, TextAlign::LEFT);
+    // The bus clock as measured: 8000 microframes/s at High Speed, 1000 frames/s at Full Speed.
+    uint32_t frames = polltestResult.highSpeed ? polltestResult.microframes : polltestResult.microframes / 8;
+    sprintf(line, "%s: %lu/s %s", polltestResult.highSpeed ? "uFrames" : "Frames", (unsigned long)lroundf(frames * scale),
+            polltestResult.highSpeed ? "HS" : "FS");
+    alignText(line, 24, TextAlign::LEFT);
+
+    // Observed poll interval: bus microframes per completed report (1.0 at 8 kHz, 8.0 at 1 kHz).
+    if (polltestResult.reports > 0) {
+        char interval[8];
+        dtostrf((float)polltestResult.microframes / polltestResult.reports, 1, 2, interval);
+        sprintf(line, "Every %s uF", interval);
+    } else {
+        sprintf(line, "No reports");
+    }
+    alignText(line, 34, TextAlign::LEFT);
+    sprintf(line, "Fail: %lu", (unsigned long)polltestResult.failures);
+    alignText(line, 44, TextAlign::LEFT);
 
-    alignText(GITHUB_TAG, 56);
+    alignText("Click button to exit.", 56);
+}
+
+// Closes the rate window once it has run POLLING_TEST_WINDOW_MS and redraws the result. The changed
+// pages then go out one per loop() pass, so the display never holds up more than a few reports.
+void pollingTestUpdate() {
+    if (displayDirtyPages != 0 && !displayFault) {
+        rendererPump();
+        return;
+    }
+    if (polltestWindowTimer < POLLING_TEST_WINDOW_MS * 1000) return;
+    polltestWindowTimer = 0;
+
+    // FRINDEX counts microframes (8 per frame at Full Speed too); its 14 bits wrap after 2048 ms.
+    static_assert(POLLING_TEST_WINDOW_MS < 2048, "The polling test window must be shorter than the FRINDEX wrap");
+    uint32_t frameIndex = USB1_FRINDEX & 0x3FFF;
+    uint32_t microframes = (frameIndex - polltestFrameIndex) & 0x3FFF;
+    polltestFrameIndex = frameIndex;
+
+    polltestResult = polltestCounts;
+    polltestResult.highSpeed = (USB1_PORTSC1 & USB_PORTSC1_HSP) != 0;
+    polltestResult.microframes = microframes;
+    polltestCounts = PollingTestStats();
+    polltestHasResult = true;
+
+    display.clearDisplay();
+    drawPollingTestScreen();
+    rendererMarkDirty();
 }
 
 // --- Generic menu drawing function to reduce code duplication ---
@@ -1486,13 +4866,13 @@ void drawGenericMenu(const char* title, const char* const options[], int optionC
 }
 
 void drawMenuScreen() {
-    const char* const menuOptions[] = {"Automatic", "Direct Auto", "Auto UE4", "Direct UE4"};
+    const char* const menuOptions[] = {"Automatic", "Direct Auto", "Auto UE4", "Direct UE4", "Direct Motion"};
     drawGenericMenu("Select Mode", menuOptions, menuOptionCount, menuSelection, menuScrollOffset, MAX_MENU_ITEMS);
 }
 
 void drawRunLimitMenuScreen() {
-    const int numNumericOptions = sizeof(RUN_LIMIT_OPTIONS) / sizeof(RUN_LIMIT_OPTIONS[0]);
-    const int totalOptions = numNumericOptions + 1;
+    const int numNumericOptions = RUN_LIMIT_OPTION_COUNT;
+    const int totalOptions = runLimitMenuOptionCount;
 
     // Create an array of char pointers for the menu text.
     const char* runLimitOptions[totalOptions];
@@ -1501,19 +4881,24 @@ void drawRunLimitMenuScreen() {
 
     // Populate numeric options from the config array
     for (int i = 0; i < numNumericOptions; ++i) {
-        sprintf(optionBuffers[i], "%lu Runs", RUN_LIMIT_OPTIONS[i]);
+        sprintf(optionBuffers[i], "%lu Runs", (unsigned long)settings.runLimitOptions[i]);
         runLimitOptions[i] = optionBuffers[i];
     }
 
-    // Add "Unlimited" option at the end
-    runLimitOptions[numNumericOptions] = "Unlimited";
+    // Then the precision target, if enabled, and "Unlimited" at the end
+    char precisionBuffer[20];
+    if (ENABLE_PRECISION_RUN_LIMIT) {
+        sprintf(precisionBuffer, "Until +/-%dus", (int)PRECISION_TARGET_MICROS);
+        runLimitOptions[numNumericOptions] = precisionBuffer;
+    }
+    runLimitOptions[totalOptions - 1] = "Unlimited";
 
     // Draw the menu using the generic function
     drawGenericMenu("Select Run Limit", runLimitOptions, totalOptions, runLimitMenuSelection, runLimitMenuScrollOffset, MAX_RUN_LIMIT_MENU_ITEMS, false);
 }
 
 void drawDebugMenuScreen() {
-    const char* const debugOptions[] = {"Mouse Debug", "LSensor Debug", "Polling Test"};
+    const char* const debugOptions[] = {"Mouse Debug", "LSensor Debug", "Polling Test", "Calibrate", "Benchmark"};
     drawGenericMenu("Debug Menu", debugOptions, debugMenuOptionCount, debugMenuSelection, debugMenuScrollOffset, MAX_MENU_ITEMS);
 }
 
@@ -1523,14 +4908,57 @@ void drawOperationScreen() {
     // In RUNS_COMPLETE state, 'selectedMode' holds the mode that was just finished.
     State modeToDisplay = (currentState == State::RUNS_COMPLETE) ? selectedMode : currentState;
 
+    StatsPage pages[MAX_STATS_PAGES];
+    StatsPage page = pages[min(statsPage, statsPageList(modeToDisplay, pages) - 1)];
+    bool tailPage = (page == StatsPage::TAIL);
+    bool sensorsPage = (page == StatsPage::SENSORS);
+
+    if (page == StatsPage::PHASE || page == StatsPage::FRAME || page == StatsPage::WAVE || page == StatsPage::BASE) {
+        const char* titles[] = {"AUTO", "DIRECT AUTO", "AUTO UE4", "DIRECT UE4", "MOTION"};
+        uint8_t modeCode = getLogModeCode(modeToDisplay);
+        if (modeCode == 0) return;
+        if (page == StatsPage::PHASE) {
+            drawPhaseScreen(titles[modeCode - 1]);
+        } else if (page == StatsPage::BASE) {
+            LatencyStats* first;
+            LatencyStats* second;
+            modeStats(modeToDisplay, first, second);
+            drawBaselineScreen(titles[modeCode - 1], first->runCount);
+        } else if (page == StatsPage::WAVE) {
+            const LatencyStats& shown = (modeToDisplay == State::AUTO_UE4_APERTURE) ? statsBtoW
+                                        : (modeToDisplay == State::DIRECT_MOTION) ? statsMotionBtoW : statsDirectBtoW;
+            drawWaveformScreen(titles[modeCode - 1], shown.runCount);
+        } else if (modeToDisplay == State::AUTO_MODE) {
+            drawFrameScreen(titles[modeCode - 1], statsAuto, nullptr);
+        } else if (modeToDisplay == State::DIRECT_AUTO_MODE) {
+            drawFrameScreen(titles[modeCode - 1], statsDirectAuto, nullptr);
+        } else if (modeToDisplay == State::AUTO_UE4_APERTURE) {
+            drawFrameScreen(titles[modeCode - 1], statsBtoW, &statsWtoB);
+        } else if (modeToDisplay == State::DIRECT_UE4_APERTURE) {
+            drawFrameScreen(titles[modeCode - 1], statsDirectBtoW, &statsDirectWtoB);
+        } else {
+            drawFrameScreen(titles[modeCode - 1], statsMotionBtoW, &statsMotionWtoB);
+        }
+        return;
+    }
+
     if (modeToDisplay == State::AUTO_MODE) {
-        drawAutoModeStatsScreen("AUTO", statsAuto);
+        if (sensorsPage) drawSensorsScreen("AUTO", statsAuto);
+        else if (tailPage) drawAutoModeTailScreen("AUTO", statsAuto);
+        else drawAutoModeStatsScreen("AUTO", statsAuto);
     } else if (modeToDisplay == State::DIRECT_AUTO_MODE) {
-        drawAutoModeStatsScreen("DIRECT AUTO", statsDirectAuto);
+        if (sensorsPage) drawSensorsScreen("DIRECT AUTO", statsDirectAuto);
+        else if (tailPage) drawAutoModeTailScreen("DIRECT AUTO", statsDirectAuto);
+        else drawAutoModeStatsScreen("DIRECT AUTO", statsDirectAuto);
     } else if (modeToDisplay == State::AUTO_UE4_APERTURE) {
-        drawUe4StatsScreen("Auto UE4 Aperture", statsBtoW, statsWtoB);
+        if (tailPage) drawUe4TailScreen("Auto UE4 Tail", statsBtoW, statsWtoB);
+        else drawUe4StatsScreen("Auto UE4 Aperture", statsBtoW, statsWtoB);
     } else if (modeToDisplay == State::DIRECT_UE4_APERTURE) {
-        drawUe4StatsScreen("Direct UE4 Aperture", statsDirectBtoW, statsDirectWtoB);
+        if (tailPage) drawUe4TailScreen("Direct UE4 Tail", statsDirectBtoW, statsDirectWtoB);
+        else drawUe4StatsScreen("Direct UE4 Aperture", statsDirectBtoW, statsDirectWtoB);
+    } else if (modeToDisplay == State::DIRECT_MOTION) {
+        if (tailPage) drawUe4TailScreen("Motion Tail", statsMotionBtoW, statsMotionWtoB);
+        else drawUe4StatsScreen("Direct Motion", statsMotionBtoW, statsMotionWtoB);
     }
 }
 
@@ -1570,17 +4998,7 @@ void drawAutoModeStatsScreen(const char* title, const LatencyStats& stats) {
     display.print("Max:");
     display.print(buf);
 
-    // --- Footer ---
-    alignText("S4N-T0S", 56, TextAlign::LEFT);
-
-    // Run count (Bottom-Right)
-    char runBuf[20];
-    if (currentState == State::RUNS_COMPLETE) {
-        sprintf(runBuf, "DONE | %lu", stats.runCount);
-    } else {
-        sprintf(runBuf, "Runs: %lu", stats.runCount);
-    }
-    alignText(runBuf, 56, TextAlign::RIGHT);
+    drawRunCountFooter(stats.runCount);
 }
 
 // Refactored function to display stats for any UE4-style mode to reduce code duplication
@@ -1632,16 +5050,303 @@ void drawUe4StatsScreen(const char* title, const LatencyStats& b_to_w_stats, con
     display.setCursor(68, 48);
     display.print("M:"); display.print(buf);
 
-    // --- Footer ---
-    alignText("S4N-T0S", 56, TextAlign::LEFT);
+    // Run count, B-to-W and W-to-B alternate so either column's count works
+    drawRunCountFooter(b_to_w_stats.runCount);
+}
+
+// Tail page for the Auto modes: percentiles and spread instead of last/min/max.
+void drawAutoModeTailScreen(const char* title, const LatencyStats& stats) {
+    char buf[16];
+
+    alignText(stats.percentilesExact ? "EXACT" : "TAIL", 0, TextAlign::LEFT);
+    alignText(title, 0, TextAlign::RIGHT);
+    display.drawLine(0, 8, SCREEN_WIDTH - 1, 8, SSD1306_WHITE);
+
+    dtostrf(statsPercentile(stats, 0), 7, 4, buf);
+    display.setCursor(0, 11);
+    display.print("p50:  "); display.print(buf); display.print("ms");
+
+    dtostrf(statsPercentile(stats, 1), 7, 4, buf);
+    display.setCursor(0, 20);
+    display.print("p90:  "); display.print(buf); display.print("ms");
+
+    dtostrf(statsPercentile(stats, 2), 7, 4, buf);
+    display.setCursor(0, 29);
+    display.print("p99:  "); display.print(buf); display.print("ms");
+
+    dtostrf(statsStdDev(stats), 7, 4, buf);
+    display.setCursor(0, 38);
+    display.print("SD:   "); display.print(buf); display.print("ms");
+
+    // Direct mode only: mean wait from the click to the next host poll
+    if (stats.usbOffsetCount > 0) {
+        dtostrf(stats.avgUsbOffsetMillis, 7, 4, buf);
+        display.setCursor(0, 47);
+        display.print("USB:  "); display.print(buf); display.print("ms");
+    }
+
+    drawRunCountFooter(stats.runCount);
+}
+
+// Tail page for the UE4 modes, one column per transition direction.
+void drawUe4TailScreen(const char* title, const LatencyStats& b_to_w_stats, const LatencyStats& w_to_b_stats) {
+    char buf[16];
+
+    alignText(title, 0);
+
+    display.setCursor(0, 12);
+    display.print("B-to-W");
+    display.setCursor(74, 12);
+    display.print("W-to-B");
+    display.drawLine(64, 10, 64, 54, SSD1306_WHITE); // Vertical divider
+
+    const char* labels[] = {"50:", "90:", "99:", "sd:"};
+    const LatencyStats* columns[] = {&b_to_w_stats, &w_to_b_stats};
+    for (int col = 0; col < 2; col++) {
+        const LatencyStats& stats = *columns[col];
+        float values[] = {statsPercentile(stats, 0), statsPercentile(stats, 1), statsPercentile(stats, 2), statsStdDev(stats)};
+        for (int row = 0; row < 4; row++) {
+            dtostrf(values[row], 6, 3, buf);
+            display.setCursor(col == 0 ? 0 : 68, 21 + row * 9);
+            display.print(labels[row]); display.print(buf);
+        }
+    }
+
+    drawRunCountFooter(b_to_w_stats.runCount);
+}
+
+// Extra sensors page for the Auto modes: average per screen position and its offset from the main sensor,
+// then the click-to-sound average and how far the sound lags the picture.
+void drawSensorsScreen(const char* title, const LatencyStats& mainStats) {
+    char buf[16];
+
+    alignText("SCAN", 0, TextAlign::LEFT);
+    alignText(title, 0, TextAlign::RIGHT);
+    display.drawLine(0, 8, SCREEN_WIDTH - 1, 8, SSD1306_WHITE);
+
+    for (int i = 0; i <= EXTRA_LIGHT_SENSOR_COUNT; i++) {
+        const LatencyStats& stats = (i == 0) ? mainStats : statsExtraSensors[i - 1];
+        display.setCursor(0, 11 + i * 9);
+        display.print("S"); display.print(i + 1); display.print(": ");
+        if (stats.runCount == 0) {
+            display.print("   --");
+            continue;
+        }
+        dtostrf(stats.avgLatency, 7, 4, buf);
+        display.print(buf);
+        if (i > 0 && mainStats.runCount > 0) {
+            float offset = stats.avgLatency - mainStats.avgLatency;
+            dtostrf(offset, 1, 3, buf);
+            display.print(offset >= 0 ? " +" : " ");
+            display.print(buf);
+        }
+    }
+
+    if (ENABLE_AUDIO_CHANNEL) {
+        display.setCursor(0, 11 + (EXTRA_LIGHT_SENSOR_COUNT + 1) * 9);
+        display.print("Snd: ");
+        if (statsAudio.runCount == 0) {
+            display.print("   --");
+        } else {
+            dtostrf(statsAudio.avgLatency, 7, 3, buf);
+            display.print(buf);
+            if (mainStats.runCount > 0) {
+                float offset = statsAudio.avgLatency - mainStats.avgLatency;
+                dtostrf(offset, 1, 2, buf);
+                display.print(offset >= 0 ? " +" : " ");
+                display.print(buf);
+            }
+        }
+    }
+
+    drawRunCountFooter(mainStats.runCount);
+}
+
+// Where the run time goes: sync wait, click issue and hold, samples until the edge, and failure counts.
+void drawPhaseScreen(const char* title) {
+    char buf[16];
+    char maxBuf[16];
+    const PhaseStats& phases = phaseStats;
+
+    alignText("PHASE", 0, TextAlign::LEFT);
+    alignText(title, 0, TextAlign::RIGHT);
+    display.drawLine(0, 8, SCREEN_WIDTH - 1, 8, SSD1306_WHITE);
+
+    dtostrf(phases.avgSyncWaitMs, 1, 1, buf);
+    dtostrf(phases.maxSyncWaitMs, 1, 1, maxBuf);
+    display.setCursor(0, 11);
+    display.print("Sync:  "); display.print(buf); display.print("/"); display.print(maxBuf); display.print("ms");
+
+    dtostrf(phases.avgClickIssueMicros, 1, 1, buf);
+    dtostrf(phases.maxClickIssueMicros, 1, 1, maxBuf);
+    display.setCursor(0, 20);
+    display.print("Click: "); display.print(buf); display.print("/"); display.print(maxBuf); display.print("us");
+
+    dtostrf(phases.avgClickHoldMs, 1, 2, buf);
+    display.setCursor(0, 29);
+    display.print("Hold:  "); display.print(buf); display.print("ms");
+
+    dtostrf(phases.avgSamples, 1, 0, buf);
+    display.setCursor(0, 38);
+    display.print("Samp:  "); display.print(buf); display.print("/"); display.print(phases.maxSamples);
+
+    // Timeouts at sync + at the edge, aborts, failed smart syncs
+    char countBuf[24];
+    snprintf(countBuf, sizeof(countBuf), "TO %lu+%lu AB %lu SS %lu", phases.syncTimeouts, phases.edgeTimeouts,
+             phases.aborts, phases.smartSyncRetries);
+    display.setCursor(0, 47);
+    display.print(countBuf);
+
+    drawRunCountFooter(phases.runCount);
+}
+
+// Detected refresh rate and the phase-balanced mean, one line per direction in the UE4 modes.
+void drawFrameScreen(const char* title, const LatencyStats& first, const LatencyStats* second) {
+    char buf[16];
+
+    alignText("FRAME", 0, TextAlign::LEFT);
+    alignText(title, 0, TextAlign::RIGHT);
+    display.drawLine(0, 8, SCREEN_WIDTH - 1, 8, SSD1306_WHITE);
+
+    display.setCursor(0, 11);
+    if (refreshPeriodCycles <= 0.0) {
+        display.print("Rate: not detected");
+        drawRunCountFooter(first.runCount);
+        return;
+    }
+    dtostrf(refreshHz, 7, 2, buf);
+    display.print("Rate: "); display.print(buf); display.print("Hz");
+
+    dtostrf(1000.0f / refreshHz, 7, 4, buf);
+    display.setCursor(0, 20);
+    display.print("Frame:"); display.print(buf); display.print("ms");
+
+    const LatencyStats* directions[2] = {&first, second};
+    const char* labels[2] = {second ? "B-W:  " : "Bal:  ", "W-B:  "};
+    for (int i = 0; i < 2 && directions[i]; i++) {
+        float spread;
+        dtostrf(statsPhaseBalancedMean(*directions[i], spread), 7, 4, buf);
+        display.setCursor(0, 29 + i * 18);
+        display.print(labels[i]); display.print(buf); display.print("ms");
+        dtostrf(spread, 7, 4, buf);
+        display.setCursor(0, 38 + i * 18);
+        display.print("Span: "); display.print(buf); display.print("ms");
+    }
+
+    drawRunCountFooter(first.runCount);
+}
+
+// Averages of the captured traces, two lines per direction, then how many runs got no trace.
+void drawWaveformScreen(const char* title, unsigned long runCount) {
+    char buf[16];
+    char line[24];
+
+    alignText("WAVE", 0, TextAlign::LEFT);
+    alignText(title, 0, TextAlign::RIGHT);
+    display.drawLine(0, 8, SCREEN_WIDTH - 1, 8, SSD1306_WHITE);
+
+    const char* labels[2] = {"B-W", "W-B"};
+    for (int i = 0; i < 2; i++) {
+        const WaveformStats& stats = waveformStats[i];
+        display.setCursor(0, 11 + i * 18);
+        if (stats.count == 0) {
+            display.print(labels[i]); display.print(" no traces");
+            continue;
+        }
+        dtostrf(stats.avgRiseMicros / 1000.0f, 1, 3, buf);
+        display.print(labels[i]); display.print(" Rise: "); display.print(buf); display.print("ms");
+        dtostrf(stats.avgSettleMicros / 1000.0f, 1, 2, buf);
+        snprintf(line, sizeof(line), "Set %sms OS %d/%d%%", buf, (int)lroundf(stats.avgOvershootPercent),
+                 (int)lroundf(stats.maxOvershootPercent));
+        display.setCursor(0, 20 + i * 18);
+        display.print(line);
+    }
+
+    snprintf(line, sizeof(line), "Skip %lu Rej %lu", waveformSkipped, waveformRejected);
+    display.setCursor(0, 47);
+    display.print(line);
+
+    drawRunCountFooter(runCount);
+}
+
+// Comparison of the completed session against its mode's baseline: change in mean and p99 per direction,
+// the verdict of the significance test and its p-values.
+void drawBaselineScreen(const char* title, unsigned long runCount) {
+    char buf[16];
+
+    alignText("CMP", 0, TextAlign::LEFT);
+    alignText(title, 0, TextAlign::RIGHT);
+    display.drawLine(0, 8, SCREEN_WIDTH - 1, 8, SSD1306_WHITE);
+
+    display.setCursor(0, 11);
+    if (!baselineLoaded) {
+        display.print("No baseline yet.");
+        display.setCursor(0, 29);
+        display.print("Hold SELECT to save");
+        display.setCursor(0, 38);
+        display.print("this session as one.");
+        drawRunCountFooter(runCount);
+        return;
+    }
+    if (baselineIsSession) {
+        display.print("Saved as baseline.");
+        drawRunCountFooter(runCount);
+        return;
+    }
+    char name[22];
+    snprintf(name, sizeof(name), "vs %s", baseline.name);
+    display.print(name);
+
+    display.setCursor(24, 20); display.print("dAvg");
+    display.setCursor(60, 20); display.print("dP99");
+    display.setCursor(96, 20); display.print("Res");
+
+    const char* labels[2] = {baseline.directions == 2 ? "B-W" : "Run", "W-B"};
+    const char* verdicts[3] = {"BETTER", "SAME", "WORSE"};
+    char pLine[24] = "p";
+    size_t pFill = 1;
+    for (int i = 0; i < baseline.directions; i++) {
+        const BaselineComparison& cmp = baselineComparison[i];
+        int y = 29 + i * 9;
+        display.setCursor(0, y);
+        display.print(labels[i]);
+        if (!cmp.valid) {
+            display.print("  --");
+            continue;
+        }
+        float deltas[2] = {cmp.deltaMeanMs, cmp.deltaP99Ms};
+        for (int k = 0; k < 2; k++) {
+            dtostrf(deltas[k], 1, 2, buf);
+            display.setCursor(24 + k * 36, y);
+            if (deltas[k] >= 0) display.print("+");
+            display.print(buf);
+        }
+        display.setCursor(96, y);
+        display.print(verdicts[cmp.verdict + 1]);
+
+        dtostrf(cmp.pValue, 1, 4, buf);
+        pFill += snprintf(pLine + pFill, sizeof(pLine) - pFill, " %s", buf);
+    }
+    display.setCursor(0, 47);
+    display.print(pLine);
+
+    drawRunCountFooter(runCount);
+}
+
+// Shared footer of every stats page: signature left, run count right.
+void drawRunCountFooter(unsigned long runCount) {
+    // The precision limit shows how far the session still is from its target instead of the signature.
+    char precisionBuf[16];
+    if (precisionRunLimit && sessionPrecisionMicros < 10000.0f) {
+        sprintf(precisionBuf, "+/-%dus", (int)ceilf(sessionPrecisionMicros));
+        alignText(precisionBuf, 56, TextAlign::LEFT);
+    } else alignText("S4N-T0S", 56, TextAlign::LEFT);
 
-    // Run count (Bottom-Right)
     char runBuf[20];
     if (currentState == State::RUNS_COMPLETE) {
-         sprintf(runBuf, "DONE | %lu", b_to_w_stats.runCount);
+        sprintf(runBuf, "DONE | %lu", runCount);
     } else {
-        // or w_to_b_stats.runCount, they should be the same
-         sprintf(runBuf, "Runs: %lu", b_to_w_stats.runCount);
+        sprintf(runBuf, "Runs: %lu", runCount);
     }
     alignText(runBuf, 56, TextAlign::RIGHT);
 }